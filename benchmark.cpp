@@ -0,0 +1,432 @@
+// headless frame benchmark: replays camera paths through the renderer
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "camera_path.h"
+#include "chunk_map.h"
+#include "game.h"
+#include "input_log.h"
+#include "profiler.h"
+#include "raycaster.h"
+#include "raycaster_baked.h"
+#include "raycaster_chunked.h"
+#include "raycaster_fixed.h"
+#include "raycaster_float.h"
+#include "raycaster_map.h"
+#include "renderer.h"
+#include "resolution_governor.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+struct BenchResult {
+    string caster;
+    string path;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    uint64_t checksum;
+    // with a frame budget: mean traced/output columns and share of misses
+    double scale;
+    double missRate;
+    // share of rays the fixed caster's hit cache answered
+    double hitRate;
+    // mean sprites drawn per frame
+    double sprites;
+    // screen columns per frame, over all cameras
+    int columns;
+};
+
+// FNV-1a over the frame, so output changes show up next to timing changes
+static uint64_t Checksum(uint64_t hash, const uint32_t *fb, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        hash = (hash ^ fb[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static double Percentile(const vector<double> &sorted, double p)
+{
+    const size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static BenchResult Run(const char *casterName,
+                       RayCaster *caster,
+                       ThreadPool *pool,
+                       const char *pathName,
+                       const vector<CameraPose> &path,
+                       const vector<float> &seconds,
+                       float budget,
+                       float offset,
+                       const RayCasterFixed *cached,
+                       bool columnMajor,
+                       bool texturedFloor,
+                       bool indexed,
+                       const Shading *shading,
+                       const TextureAtlas *atlas,
+                       const SpriteGrid *sprites,
+                       int cameraCount)
+{
+    // cameras past the first trace clones of the caster, looking around
+    // from the same spot, stacked in one frame
+    vector<unique_ptr<RayCaster>> clones;
+    vector<unique_ptr<Renderer>> renderers;
+    vector<unique_ptr<ResolutionGovernor>> governors;
+    for (int i = 0; i < cameraCount; i++) {
+        RayCaster *rc = caster;
+        if (i > 0) {
+            clones.push_back(caster->Clone());
+            rc = clones.back().get();
+        }
+        renderers.emplace_back(new Renderer(rc, pool));
+        Renderer &renderer = *renderers.back();
+        renderer.SetShading(shading);
+        renderer.SetAtlas(atlas);
+        renderer.SetSprites(sprites);
+        renderer.SetColumnMajor(columnMajor);
+        renderer.SetTexturedFloor(texturedFloor);
+        governors.emplace_back(new ResolutionGovernor(budget));
+        if (budget > 0) {
+            renderer.SetGovernor(governors.back().get());
+        }
+    }
+    const ResolutionGovernor &governor = *governors[0];
+    double scale = 0;
+    double visible = 0;
+    Game game;
+    const size_t frameSize = SCREEN_WIDTH * SCREEN_HEIGHT;
+    vector<uint32_t> fb(frameSize * cameraCount);
+    vector<uint8_t> indexedFb(indexed ? fb.size() : 0);
+    vector<Camera<uint32_t>> cameras(cameraCount);
+    vector<Camera<uint8_t>> indexedCameras(cameraCount);
+    for (int i = 0; i < cameraCount; i++) {
+        cameras[i].renderer = renderers[i].get();
+        cameras[i].target.pixels = fb.data() + i * frameSize;
+        indexedCameras[i].renderer = renderers[i].get();
+        if (indexed) {
+            indexedCameras[i].target.pixels = indexedFb.data() + i * frameSize;
+        }
+    }
+    // indexed frames are timed up to the expanded ARGB frame
+    const auto render = [&]() {
+        for (int i = 0; i < cameraCount; i++) {
+            const float a = game.playerA + i * 2.0f * M_PI / cameraCount;
+            cameras[i].x = indexedCameras[i].x = game.playerX;
+            cameras[i].y = indexedCameras[i].y = game.playerY;
+            cameras[i].a = indexedCameras[i].a = a;
+        }
+        if (indexed) {
+            Renderer::TraceFrames(&game, indexedCameras.data(), cameraCount,
+                                  pool);
+            Renderer::ExpandIndexed(indexedFb.data(), fb.data(), fb.size());
+        } else {
+            Renderer::TraceFrames(&game, cameras.data(), cameraCount, pool);
+        }
+    };
+    vector<double> ns;
+    ns.reserve(path.size());
+    uint64_t checksum = 0xcbf29ce484222325ULL;
+
+    // warm caches and wake the pool
+    for (size_t i = 0; i < std::min<size_t>(path.size(), 16); i++) {
+        render();
+    }
+    const uint64_t hits = cached ? cached->CacheHits() : 0;
+    const uint64_t misses = cached ? cached->CacheMisses() : 0;
+
+    for (size_t i = 0; i < path.size(); i++) {
+        const CameraPose &pose = path[i];
+        game.playerX = pose.playerX + offset;
+        game.playerY = pose.playerY + offset;
+        game.playerA = pose.playerA;
+        // a replayed session moves the doors as Game::Move did
+        if (!seconds.empty()) {
+            game.doors.Update(pose.playerX, pose.playerY, seconds[i]);
+        }
+        const auto start = chrono::steady_clock::now();
+        render();
+        const auto end = chrono::steady_clock::now();
+        ns.push_back(chrono::duration<double, nano>(end - start).count());
+        Profiler::EndFrame();
+        scale += governor.Scale();
+        for (const auto &renderer : renderers) {
+            visible += renderer->VisibleSprites();
+        }
+        checksum = Checksum(checksum, fb.data(), fb.size());
+    }
+
+    BenchResult r;
+    r.caster = casterName;
+    r.path = pathName;
+    r.mean = 0;
+    for (auto v : ns) {
+        r.mean += v;
+    }
+    r.mean /= ns.size();
+    sort(ns.begin(), ns.end());
+    r.p50 = Percentile(ns, 0.50);
+    r.p90 = Percentile(ns, 0.90);
+    r.p99 = Percentile(ns, 0.99);
+    r.max = ns.back();
+    r.checksum = checksum;
+    r.scale = budget > 0 ? scale / path.size() : 1.0;
+    r.sprites = visible / (path.size() * cameraCount);
+    r.columns = SCREEN_WIDTH * cameraCount;
+    r.missRate = 0;
+    if (budget > 0) {
+        // the warm-up frames count as governor frames too
+        r.missRate =
+            governor.Misses() / static_cast<double>(governor.Frames());
+    }
+    r.hitRate = 0;
+    if (cached) {
+        const uint64_t h = cached->CacheHits() - hits;
+        const uint64_t m = cached->CacheMisses() - misses;
+        r.hitRate = h / static_cast<double>(std::max<uint64_t>(h + m, 1));
+    }
+    return r;
+}
+
+static void WriteJson(FILE *f,
+                      const vector<BenchResult> &results,
+                      int frames,
+                      unsigned threads,
+                      float budget,
+                      bool columnMajor,
+                      bool texturedFloor,
+                      bool indexed,
+                      float fog,
+                      uint32_t sprites,
+                      int cameras)
+{
+    fprintf(f, "{\n");
+    fprintf(f, "  \"width\": %d,\n  \"height\": %d,\n", SCREEN_WIDTH,
+            SCREEN_HEIGHT);
+    fprintf(f, "  \"frames\": %d,\n  \"threads\": %u,\n", frames, threads);
+    fprintf(f, "  \"budget_ns\": %.0f,\n", budget * 1e9);
+    fprintf(f, "  \"column_major\": %s,\n", columnMajor ? "true" : "false");
+    fprintf(f, "  \"textured_floor\": %s,\n",
+            texturedFloor ? "true" : "false");
+    fprintf(f, "  \"indexed\": %s,\n", indexed ? "true" : "false");
+    fprintf(f, "  \"fog_distance\": %.2f,\n", fog);
+    fprintf(f, "  \"sprites\": %u,\n", sprites);
+    fprintf(f, "  \"cameras\": %d,\n", cameras);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        fprintf(f,
+                "    {\"caster\": \"%s\", \"path\": \"%s\", "
+                "\"ns_per_column\": %.2f, \"frames_per_second\": %.2f, "
+                "\"ns_per_frame\": {\"mean\": %.1f, \"p50\": %.1f, "
+                "\"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}, "
+                "\"scale\": %.3f, \"budget_miss_rate\": %.4f, "
+                "\"cache_hit_rate\": %.4f, \"visible_sprites\": %.1f, "
+                "\"checksum\": \"%016llx\"}%s\n",
+                r.caster.c_str(), r.path.c_str(), r.mean / r.columns,
+                1e9 / r.mean, r.mean, r.p50, r.p90, r.p99, r.max, r.scale,
+                r.missRate, r.hitRate, r.sprites,
+                static_cast<unsigned long long>(r.checksum),
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n frames] [-j threads] [-b budget_us] "
+            "[-t hits.bin] [-c] [-f] [-i] [-d tiles] [-s sprites]\n"
+            "       [-m cameras] [-o results.json] [-p trace.json] "
+            "[-r session.log]\n"
+            "  -n  frames per camera path (default 1000)\n"
+            "  -j  render threads, 1 renders on the calling thread\n"
+            "  -b  frame budget for the resolution governor\n"
+            "  -t  also run the baked caster on a hit_baker table\n"
+            "  -c  fill a column-major frame and transpose it\n"
+            "  -f  textured floor and ceiling\n"
+            "  -i  render 8-bit indexed frames and expand them to ARGB\n"
+            "  -d  fade to fog over this many tiles\n"
+            "  -s  scatter this many sprites over the map\n"
+            "  -m  trace this many cameras per frame, batched together\n"
+            "  -o  write machine-readable results\n"
+            "  -p  record a Chrome trace of the timed frames, needs a "
+            "RAYCASTER_PROFILE build\n"
+            "  -r  time a session recorded with raycaster -r instead of the "
+            "camera paths\n",
+            name);
+}
+
+int main(int argc, char *args[])
+{
+    int frames = 1000;
+    unsigned threads = 1;
+    float budget = 0;
+    const char *jsonPath = nullptr;
+    const char *tracePath = nullptr;
+    const char *replayPath = nullptr;
+    const char *hitsPath = nullptr;
+    bool columnMajor = false;
+    bool texturedFloor = false;
+    bool indexed = false;
+    float fog = 0;
+    uint32_t spriteCount = 0;
+    int cameras = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-n") && i + 1 < argc) {
+            frames = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-j") && i + 1 < argc) {
+            threads = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-b") && i + 1 < argc) {
+            budget = atof(args[++i]) / 1e6f;
+        } else if (!strcmp(args[i], "-t") && i + 1 < argc) {
+            hitsPath = args[++i];
+        } else if (!strcmp(args[i], "-c")) {
+            columnMajor = true;
+        } else if (!strcmp(args[i], "-f")) {
+            texturedFloor = true;
+        } else if (!strcmp(args[i], "-i")) {
+            indexed = true;
+        } else if (!strcmp(args[i], "-d") && i + 1 < argc) {
+            fog = atof(args[++i]);
+        } else if (!strcmp(args[i], "-s") && i + 1 < argc) {
+            spriteCount = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-m") && i + 1 < argc) {
+            cameras = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-o") && i + 1 < argc) {
+            jsonPath = args[++i];
+        } else if (!strcmp(args[i], "-p") && i + 1 < argc) {
+            tracePath = args[++i];
+        } else if (!strcmp(args[i], "-r") && i + 1 < argc) {
+            replayPath = args[++i];
+        } else {
+            Usage(args[0]);
+            return 1;
+        }
+    }
+    if (frames <= 0 || cameras <= 0 || (tracePath && !Profiler::Enabled())) {
+        Usage(args[0]);
+        return 1;
+    }
+    if (tracePath && !Profiler::OpenTrace(tracePath)) {
+        perror(tracePath);
+        return 1;
+    }
+
+    // the poses of each path, and for a session the time steps that move
+    // its doors
+    struct BenchPath {
+        const char *name;
+        vector<CameraPose> poses;
+        vector<float> seconds;
+    };
+    vector<BenchPath> paths;
+    if (replayPath) {
+        const auto replay = InputReplay::Open(replayPath);
+        if (!replay || replay->Frames().empty()) {
+            fprintf(stderr, "%s is not an input log\n", replayPath);
+            return 1;
+        }
+        paths.push_back({"replay", {}, {}});
+        for (const auto &f : replay->Frames()) {
+            paths.back().poses.push_back({f.playerX, f.playerY, f.playerA});
+            paths.back().seconds.push_back(f.seconds);
+        }
+        frames = replay->Frames().size();
+    } else {
+        for (int p = 0; p < PATH_COUNT; p++) {
+            const auto type = static_cast<CameraPathType>(p);
+            paths.push_back(
+                {CameraPathName(type), MakeCameraPath(type, frames), {}});
+        }
+    }
+
+    Shading shading;
+    shading.SetFog(FOG_COLOUR, fog);
+    // orbs, stored past the wall materials
+    const uint8_t orb = MATERIAL_COUNT;
+    uint8_t orbTexels[TEXTURE_SIZE * TEXTURE_SIZE];
+    SpriteOrb(orbTexels);
+    TextureAtlas atlas;
+    atlas.SetTexture(orb, orbTexels);
+    SpriteGrid sprites(MAP_X, MAP_Y);
+    ScatterSprites(&sprites, spriteCount, orb, 1);
+    unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool.reset(new ThreadPool(threads));
+    }
+    RayCasterFixed fixedCaster;
+    RayCasterFloat floatCaster;
+    // g_map as one chunk, matches fixed; and the paths moved into the middle
+    // of a generated world of 128 x 128 chunks
+    ChunkMap smallMap(MAP_X, MAP_Y, 1, LoadMapChunk);
+    ChunkMap largeMap(4096, 4096, 256, GenerateChunk);
+    RayCasterChunked chunkedCaster(&smallMap);
+    RayCasterChunked largeCaster(&largeMap);
+    unique_ptr<RayCasterBaked> bakedCaster;
+    if (hitsPath) {
+        bakedCaster = RayCasterBaked::Open(hitsPath);
+        if (!bakedCaster) {
+            fprintf(stderr, "%s: not a hit table for this map\n", hitsPath);
+            return 1;
+        }
+    }
+    struct CasterEntry {
+        const char *name;
+        RayCaster *caster;
+        float offset;
+        const RayCasterFixed *cached;
+    };
+    vector<CasterEntry> casters = {{"fixed", &fixedCaster, 0, &fixedCaster},
+                                   {"float", &floatCaster, 0, nullptr},
+                                   {"chunked", &chunkedCaster, 0, nullptr},
+                                   {"large", &largeCaster, 2048, nullptr}};
+    if (bakedCaster) {
+        casters.push_back({"baked", bakedCaster.get(), 0, nullptr});
+    }
+
+    vector<BenchResult> results;
+    printf("%-8s %-10s %10s %10s %10s %10s %10s %6s %6s %6s %7s\n",
+           "caster", "path", "ns/column", "p50 ns", "p90 ns", "p99 ns",
+           "frames/s", "scale", "miss", "hits", "sprites");
+    for (const auto &c : casters) {
+        for (const auto &p : paths) {
+            const auto r = Run(c.name, c.caster, pool.get(), p.name, p.poses,
+                               p.seconds, budget, c.offset, c.cached,
+                               columnMajor, texturedFloor, indexed, &shading,
+                               &atlas, spriteCount > 0 ? &sprites : nullptr,
+                               cameras);
+            printf("%-8s %-10s %10.1f %10.0f %10.0f %10.0f %10.1f %6.2f "
+                   "%6.3f %6.3f %7.1f\n",
+                   r.caster.c_str(), r.path.c_str(), r.mean / r.columns,
+                   r.p50, r.p90, r.p99, 1e9 / r.mean, r.scale, r.missRate,
+                   r.hitRate, r.sprites);
+            results.push_back(r);
+        }
+    }
+
+    if (jsonPath) {
+        FILE *f = fopen(jsonPath, "w");
+        if (!f) {
+            perror(jsonPath);
+            return 1;
+        }
+        WriteJson(f, results, frames, threads, budget, columnMajor,
+                  texturedFloor, indexed, fog, spriteCount, cameras);
+        fclose(f);
+    }
+    Profiler::CloseTrace();
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "camera_path.h"
+#include <math.h>
+#include <stdint.h>
+#include "raycaster.h"
+#include "raycaster_data.h"
+
+static bool IsOpen(float x, float y)
+{
+    const int tileX = static_cast<int>(x);
+    const int tileY = static_cast<int>(y);
+    return !(g_map[(tileX >> 3) + (tileY << (MAP_XS - 3))] &
+             (1 << (8 - (tileX & 0x7))));
+}
+
+const char *CameraPathName(CameraPathType type)
+{
+    switch (type) {
+    case PATH_SPIN:
+        return "spin";
+    case PATH_CORRIDOR:
+        return "corridor";
+    case PATH_WALL_HUG:
+        return "wall_hug";
+    case PATH_RANDOM:
+        return "random";
+    default:
+        return "unknown";
+    }
+}
+
+std::vector<CameraPose> MakeCameraPath(CameraPathType type, int frames)
+{
+    std::vector<CameraPose> path;
+    path.reserve(frames);
+    uint32_t seed = 0x2545F491;
+
+    for (int i = 0; i < frames; i++) {
+        const float t = frames > 1 ? i / static_cast<float>(frames - 1) : 0;
+        CameraPose pose;
+        switch (type) {
+        case PATH_SPIN:
+            pose = {23.03f, 6.8f, static_cast<float>(2.0f * M_PI * t)};
+            break;
+        case PATH_CORRIDOR:
+            // east along y = 13.5, swaying +-30 degrees
+            pose = {1.5f + 28.0f * t, 13.5f,
+                    static_cast<float>(M_PI_2 + 0.5f * sinf(12.0f * t))};
+            break;
+        case PATH_WALL_HUG:
+            // row 12 is wall from x = 8 to x = 28
+            pose = {8.5f + 19.0f * t, 11.75f, 0.0f};
+            break;
+        default:
+            do {
+                seed = seed * 1664525 + 1013904223;
+                pose.playerX = 1.05f + (seed >> 8) % 2890 / 100.0f;
+                seed = seed * 1664525 + 1013904223;
+                pose.playerY = 1.05f + (seed >> 8) % 2890 / 100.0f;
+                seed = seed * 1664525 + 1013904223;
+                pose.playerA = (seed >> 8) % 6283 / 1000.0f;
+            } while (!IsOpen(pose.playerX, pose.playerY));
+            break;
+        }
+        path.push_back(pose);
+    }
+    return path;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+struct CameraPose {
+    float playerX;
+    float playerY;
+    float playerA;
+};
+
+enum CameraPathType {
+    PATH_SPIN,       // rotate in place at the start position
+    PATH_CORRIDOR,   // walk down the open row below the wall block
+    PATH_WALL_HUG,   // slide along a wall a quarter tile away, facing it
+    PATH_RANDOM,     // seeded random poses in open tiles
+    PATH_COUNT
+};
+
+const char *CameraPathName(CameraPathType type);
+
+// deterministic poses for a run of frames
+std::vector<CameraPose> MakeCameraPath(CameraPathType type, int frames);
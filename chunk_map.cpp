@@ -0,0 +1,184 @@
+#include "chunk_map.h"
+#include <string.h>
+#include "raycaster.h"
+#include "raycaster_fixed_kernels.h"
+#include "raycaster_map.h"
+
+static uint64_t ChunkKey(int32_t chunkX, int32_t chunkY)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(chunkY)) << 32) |
+           static_cast<uint32_t>(chunkX);
+}
+
+// occupancy summaries of 4x4 and 16x16 blocks, spread over the tiles
+static void BuildOccupancy(Chunk *chunk)
+{
+    constexpr int blocks = CHUNK_SIZE / 4;
+    uint8_t walls4[blocks * blocks] = {};
+    uint8_t walls16[(CHUNK_SIZE / 16) * (CHUNK_SIZE / 16)] = {};
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            if (chunk->tiles[(y << CHUNK_SHIFT) + x]) {
+                walls4[(y >> 2) * blocks + (x >> 2)] = 1;
+                walls16[(y >> 4) * (CHUNK_SIZE / 16) + (x >> 4)] = 1;
+            }
+        }
+    }
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            uint8_t cell = 0;
+            if (chunk->tiles[(y << CHUNK_SHIFT) + x]) {
+                cell = OCC_WALL;
+            } else if (!walls16[(y >> 4) * (CHUNK_SIZE / 16) + (x >> 4)]) {
+                cell = 4;
+            } else if (!walls4[(y >> 2) * blocks + (x >> 2)]) {
+                cell = 2;
+            }
+            chunk->occupancy[(y << CHUNK_SHIFT) + x] = cell;
+        }
+    }
+}
+
+std::shared_ptr<const Chunk> ChunkMap::Get(int32_t chunkX, int32_t chunkY)
+{
+    if (chunkX < 0 || chunkY < 0 ||
+        static_cast<uint32_t>(chunkX) > (_width - 1) >> CHUNK_SHIFT ||
+        static_cast<uint32_t>(chunkY) > (_height - 1) >> CHUNK_SHIFT) {
+        return _solid;
+    }
+
+    const uint64_t key = ChunkKey(chunkX, chunkY);
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto it = _index.find(key);
+        if (it != _index.end()) {
+            _lru.splice(_lru.begin(), _lru, it->second);
+            return it->second->second;
+        }
+    }
+
+    // load outside the lock, a racing thread may load the same chunk twice
+    auto chunk = Load(chunkX, chunkY);
+
+    std::lock_guard<std::mutex> lock(_lock);
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->second;
+    }
+    _lru.emplace_front(key, chunk);
+    _index[key] = _lru.begin();
+    _loads++;
+    while (_lru.size() > _capacity) {
+        _index.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    return chunk;
+}
+
+std::shared_ptr<const Chunk> ChunkMap::Load(int32_t chunkX, int32_t chunkY)
+{
+    auto chunk = std::make_shared<Chunk>();
+    memset(chunk->tiles, 0, sizeof(chunk->tiles));
+    _loader(chunkX, chunkY, chunk.get());
+
+    // wall off the part of an edge chunk that lies outside the world
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            const uint32_t tileX = (chunkX << CHUNK_SHIFT) + x;
+            const uint32_t tileY = (chunkY << CHUNK_SHIFT) + y;
+            if (tileX >= _width || tileY >= _height) {
+                chunk->tiles[(y << CHUNK_SHIFT) + x] = MATERIAL_BORDER;
+            }
+        }
+    }
+    BuildOccupancy(chunk.get());
+    return chunk;
+}
+
+bool ChunkMap::IsWall(int32_t tileX, int32_t tileY)
+{
+    const auto chunk = Get(tileX >> CHUNK_SHIFT, tileY >> CHUNK_SHIFT);
+    return chunk->tiles[((tileY & CHUNK_MASK) << CHUNK_SHIFT) +
+                        (tileX & CHUNK_MASK)];
+}
+
+size_t ChunkMap::Resident() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _lru.size();
+}
+
+uint64_t ChunkMap::Loads() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _loads;
+}
+
+ChunkMap::ChunkMap(uint32_t width,
+                   uint32_t height,
+                   size_t capacity,
+                   Loader loader)
+    : _width(width),
+      _height(height),
+      _capacity(capacity > 0 ? capacity : 1),
+      _loader(loader)
+{
+    auto solid = std::make_shared<Chunk>();
+    memset(solid->tiles, MATERIAL_BORDER, sizeof(solid->tiles));
+    BuildOccupancy(solid.get());
+    _solid = solid;
+}
+
+void LoadMapChunk(int32_t chunkX, int32_t chunkY, Chunk *chunk)
+{
+    if (chunkX != 0 || chunkY != 0) {
+        return;
+    }
+    for (int y = 0; y < MAP_Y; y++) {
+        for (int x = 0; x < MAP_X; x++) {
+            // the chunked caster has no door test, doorways stay open
+            const uint8_t tile = g_tiles[TileIndex(x, y)];
+            chunk->tiles[(y << CHUNK_SHIFT) + x] =
+                tile == MATERIAL_DOOR ? 0 : tile;
+        }
+    }
+}
+
+static uint32_t Hash(uint32_t x, uint32_t y)
+{
+    uint32_t h = x * 0x9E3779B1u ^ y * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+void GenerateChunk(int32_t chunkX, int32_t chunkY, Chunk *chunk)
+{
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            const uint32_t tileX = (chunkX << CHUNK_SHIFT) + x;
+            const uint32_t tileY = (chunkY << CHUNK_SHIFT) + y;
+            // room walls every 16 tiles, each side with a 2-tile doorway
+            const uint32_t roomX = tileX >> 4;
+            const uint32_t roomY = tileY >> 4;
+            uint8_t material = 0;
+            if ((tileX & 15) == 0) {
+                const uint32_t door = 2 + Hash(roomX, roomY * 2) % 12;
+                if ((tileY & 15) != door && (tileY & 15) != door + 1) {
+                    material = MATERIAL_WALL;
+                }
+            } else if ((tileY & 15) == 0) {
+                const uint32_t door = 2 + Hash(roomX, roomY * 2 + 1) % 12;
+                if ((tileX & 15) != door && (tileX & 15) != door + 1) {
+                    material = MATERIAL_WALL;
+                }
+            } else if ((tileX & 3) == 2 && (tileY & 3) == 2 &&
+                       Hash(tileX, tileY) % 5 == 0) {
+                material = MATERIAL_PILLAR;
+            }
+            chunk->tiles[(y << CHUNK_SHIFT) + x] = material;
+        }
+    }
+}
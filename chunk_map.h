@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#define CHUNK_SHIFT 5
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+#define CHUNK_MASK (CHUNK_SIZE - 1)
+
+// CHUNK_SIZE x CHUNK_SIZE tiles, row-major, holding materials as g_tiles
+struct Chunk {
+    uint8_t tiles[CHUNK_SIZE * CHUNK_SIZE];
+    // filled in by ChunkMap from tiles, encoded as g_occupancy
+    uint8_t occupancy[CHUNK_SIZE * CHUNK_SIZE];
+};
+
+// a large tile world, loaded one chunk at a time on demand and kept in a
+// least-recently-used cache of bounded size; tiles outside the world are
+// walls
+class ChunkMap
+{
+public:
+    // fills a chunk given its chunk coordinates
+    typedef std::function<void(int32_t chunkX, int32_t chunkY, Chunk *chunk)>
+        Loader;
+
+    // the chunk stays valid while the returned pointer is held, even after
+    // it is evicted; safe to call from several threads
+    std::shared_ptr<const Chunk> Get(int32_t chunkX, int32_t chunkY);
+
+    // slow path for one-off queries, the casters walk chunks themselves
+    bool IsWall(int32_t tileX, int32_t tileY);
+
+    uint32_t Width() const { return _width; }
+    uint32_t Height() const { return _height; }
+    size_t Resident() const;
+    uint64_t Loads() const;
+
+    // width and height in tiles, below 2^23 so 24.8 positions fit in 32 bits;
+    // capacity in chunks
+    ChunkMap(uint32_t width, uint32_t height, size_t capacity, Loader loader);
+    ~ChunkMap(){};
+
+private:
+    typedef std::pair<uint64_t, std::shared_ptr<const Chunk>> Entry;
+
+    std::shared_ptr<const Chunk> Load(int32_t chunkX, int32_t chunkY);
+
+    uint32_t _width;
+    uint32_t _height;
+    size_t _capacity;
+    Loader _loader;
+    std::shared_ptr<const Chunk> _solid;
+    mutable std::mutex _lock;
+    // most recently used first
+    std::list<Entry> _lru;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> _index;
+    uint64_t _loads = 0;
+};
+
+// g_tiles in chunk (0, 0) with its doors open, open everywhere else
+void LoadMapChunk(int32_t chunkX, int32_t chunkY, Chunk *chunk);
+
+// rooms of 16 x 16 tiles with doorways and pillars, seeded by position
+void GenerateChunk(int32_t chunkX, int32_t chunkY, Chunk *chunk);
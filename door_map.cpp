@@ -0,0 +1,32 @@
+#include "door_map.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+void DoorMap::SetOpen(int door, uint16_t open)
+{
+    open = std::min<uint16_t>(open, DOOR_OPEN);
+    if (open != _open[door]) {
+        _open[door] = open;
+        _version++;
+    }
+}
+
+void DoorMap::Update(float playerX, float playerY, float seconds)
+{
+    const int step = std::max<int>(DOOR_SPEED * DOOR_OPEN * seconds, 1);
+    for (int i = 0; i < DOOR_COUNT; i++) {
+        const float dx = g_doorTiles[i].x + 0.5f - playerX;
+        const float dy = g_doorTiles[i].y + 0.5f - playerY;
+        if (sqrtf(dx * dx + dy * dy) <= DOOR_REACH) {
+            SetOpen(i, std::min(_open[i] + step, DOOR_OPEN));
+        } else {
+            SetOpen(i, std::max(_open[i] - step, 0));
+        }
+    }
+}
+
+DoorMap::DoorMap()
+{
+    memset(_open, 0, sizeof(_open));
+}
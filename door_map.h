@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include "raycaster_map.h"
+
+// tiles from a door's centre within which it opens for the player
+#define DOOR_REACH 2.0f
+// tiles per second a door slides
+#define DOOR_SPEED 1.5f
+
+// the open amounts of the doors of g_doorTiles. The casters read them while
+// tracing, so changing a door only writes here; Version() tells casters
+// holding results from the old state to drop them
+class DoorMap
+{
+public:
+    // in 1/256 tiles, 0 closed to DOOR_OPEN
+    uint16_t Open(int door) const { return _open[door]; }
+    const uint16_t *OpenAmounts() const { return _open; }
+    void SetOpen(int door, uint16_t open);
+    // changes on every SetOpen that moves a door
+    uint32_t Version() const { return _version; }
+
+    // slide the doors within DOOR_REACH of the player open and the others
+    // shut
+    void Update(float playerX, float playerY, float seconds);
+
+    DoorMap();
+    ~DoorMap(){};
+
+private:
+    uint16_t _open[DOOR_COUNT];
+    uint32_t _version = 0;
+};
@@ -0,0 +1,123 @@
+#include "frame_pipeline.h"
+
+template <typename Ready>
+void FramePipeline::Wait(Ready ready)
+{
+    if (ready()) {
+        return;
+    }
+    // either Wake sees the sleeper or this sees what it published
+    _sleepers++;
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _wake.wait(lock, ready);
+    }
+    _sleepers--;
+}
+
+void FramePipeline::Wake()
+{
+    if (_sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(_lock);
+        _wake.notify_all();
+    }
+}
+
+void FramePipeline::TraceLoop()
+{
+    for (uint64_t written = 0;; written++) {
+        Wait([this, written] {
+            return _exiting.load() ||
+                   written - _released.load() < FRAME_RING_SIZE;
+        });
+        if (_exiting) {
+            return;
+        }
+        PipelineFrame &frame = _ring[written % FRAME_RING_SIZE];
+        frame.started = Clock::now();
+        _trace(frame.pixels.data());
+        frame.traced = Clock::now();
+        _traceNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        frame.traced - frame.started)
+                        .count();
+        _written = written + 1;
+        Wake();
+    }
+}
+
+const PipelineFrame &FramePipeline::Acquire()
+{
+    Wait([this] { return _written.load() > _acquired; });
+    _acquiredAt = Clock::now();
+    const PipelineFrame &frame = _ring[_acquired % FRAME_RING_SIZE];
+    _queueSeconds +=
+        std::chrono::duration<double>(_acquiredAt - frame.traced).count();
+    _acquired++;
+    return frame;
+}
+
+void FramePipeline::Release()
+{
+    const auto now = Clock::now();
+    const PipelineFrame &frame = _ring[(_acquired - 1) % FRAME_RING_SIZE];
+    _presentSeconds +=
+        std::chrono::duration<double>(now - _acquiredAt).count();
+    _latencySeconds +=
+        std::chrono::duration<double>(now - frame.started).count();
+    _frames++;
+    _released = _acquired;
+    Wake();
+}
+
+float FramePipeline::TraceOccupancy() const
+{
+    const double wall =
+        std::chrono::duration<double>(Clock::now() - _statsStart).count();
+    return (_traceNs.load() - _statsTraceNs) * 1e-9 / wall;
+}
+
+float FramePipeline::PresentOccupancy() const
+{
+    const double wall =
+        std::chrono::duration<double>(Clock::now() - _statsStart).count();
+    return _presentSeconds / wall;
+}
+
+float FramePipeline::Latency() const
+{
+    return _frames > 0 ? _latencySeconds / _frames : 0;
+}
+
+float FramePipeline::QueueLatency() const
+{
+    return _frames > 0 ? _queueSeconds / _frames : 0;
+}
+
+void FramePipeline::ResetStats()
+{
+    _statsStart = Clock::now();
+    _statsTraceNs = _traceNs.load();
+    _frames = 0;
+    _presentSeconds = 0;
+    _latencySeconds = 0;
+    _queueSeconds = 0;
+}
+
+FramePipeline::FramePipeline(size_t pixels, Trace trace) : _trace(trace)
+{
+    for (auto &frame : _ring) {
+        frame.pixels.resize(pixels);
+    }
+    ResetStats();
+    _thread = std::thread(&FramePipeline::TraceLoop, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+    _exiting = true;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _wake.notify_all();
+    }
+    _thread.join();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// frames in flight: one being traced, one ready, one being presented
+#define FRAME_RING_SIZE 3
+
+// a frame handed from the tracing thread to the presenting one
+struct PipelineFrame {
+    std::vector<uint32_t> pixels;
+    // when tracing it began and ended
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point traced;
+};
+
+// traces frames on a thread of its own while the caller presents the ones
+// before them, so frame N + 1 is traced while frame N is uploaded. Frames
+// pass through a ring of FRAME_RING_SIZE buffers whose indices are swapped
+// without locks; a side only sleeps when the ring is full or empty
+class FramePipeline
+{
+public:
+    // fills a frame of the pixels given to the constructor
+    typedef std::function<void(uint32_t *pixels)> Trace;
+
+    // the oldest frame traced and not presented yet, waiting for one
+    const PipelineFrame &Acquire();
+    // done presenting the acquired frame, its buffer goes back to tracing
+    void Release();
+
+    // the statistics are kept by the presenting thread, since the last
+    // ResetStats: the share of the time the tracing thread traced and the
+    // presenting thread held a frame
+    float TraceOccupancy() const;
+    float PresentOccupancy() const;
+    // mean seconds from the start of tracing a frame to its release, and
+    // the part of it the frame sat ready in the ring
+    float Latency() const;
+    float QueueLatency() const;
+    uint64_t Frames() const { return _frames; }
+    void ResetStats();
+
+    // starts tracing right away
+    FramePipeline(size_t pixels, Trace trace);
+    ~FramePipeline();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void TraceLoop();
+    // sleep until ready(), which the other side makes true
+    template <typename Ready>
+    void Wait(Ready ready);
+    void Wake();
+
+    Trace _trace;
+    PipelineFrame _ring[FRAME_RING_SIZE];
+    // frames published by the tracing thread and released by the
+    // presenting one; the presenting thread also counts its acquires
+    alignas(64) std::atomic<uint64_t> _written{0};
+    alignas(64) std::atomic<uint64_t> _released{0};
+    uint64_t _acquired = 0;
+    std::atomic<bool> _exiting{false};
+
+    // the slow path, only taken with a side asleep
+    std::atomic<int> _sleepers{0};
+    std::mutex _lock;
+    std::condition_variable _wake;
+
+    // nanoseconds the tracing thread spent tracing
+    std::atomic<uint64_t> _traceNs{0};
+    Clock::time_point _statsStart;
+    uint64_t _statsTraceNs = 0;
+    Clock::time_point _acquiredAt;
+    uint64_t _frames = 0;
+    double _presentSeconds = 0;
+    double _latencySeconds = 0;
+    double _queueSeconds = 0;
+
+    std::thread _thread;
+};
@@ -19,14 +19,16 @@ void Game::Move(int m, int r, float seconds)
 
     if (playerX < 1) {
         playerX = 1.01f;
-    } else if (playerX > MAP_X - 2) {
-        playerX = MAP_X - 2 - 0.01f;
+    } else if (playerX > mapWidth - 2) {
+        playerX = mapWidth - 2 - 0.01f;
     }
     if (playerY < 1) {
         playerY = 1.01f;
-    } else if (playerY > MAP_Y - 2) {
-        playerY = MAP_Y - 2 - 0.01f;
+    } else if (playerY > mapHeight - 2) {
+        playerY = mapHeight - 2 - 0.01f;
     }
+
+    doors.Update(playerX, playerY, seconds);
 }
 
 Game::Game()
@@ -34,6 +36,8 @@ Game::Game()
     playerX = 23.03f;
     playerY = 6.8f;
     playerA = 5.25f;
+    mapWidth = MAP_X;
+    mapHeight = MAP_Y;
 }
 
 Game::~Game() {}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include "door_map.h"
 
 class Game
 {
@@ -8,6 +9,10 @@ public:
     void Move(int m, int r, float seconds);
 
     float playerX, playerY, playerA;
+    // world size in tiles, the player stays one tile inside it
+    uint32_t mapWidth, mapHeight;
+    // opened by Move as the player comes near
+    DoorMap doors;
 
     Game();
     ~Game();
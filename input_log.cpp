@@ -0,0 +1,99 @@
+#include "input_log.h"
+#include <string.h>
+
+struct InputHeader {
+    uint32_t magic;
+    uint32_t version;
+    float playerX;
+    float playerY;
+    float playerA;
+};
+
+std::unique_ptr<InputRecorder> InputRecorder::Open(const char *path,
+                                                   const Game &game)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+    std::unique_ptr<InputRecorder> recorder(new InputRecorder(file));
+    const InputHeader header = {INPUT_LOG_MAGIC, INPUT_LOG_VERSION,
+                                game.playerX, game.playerY, game.playerA};
+    recorder->_failed = fwrite(&header, sizeof(header), 1, file) != 1;
+    return recorder;
+}
+
+bool InputRecorder::Add(int move, int rotate, float seconds, const Game &game)
+{
+    if (_failed) {
+        return false;
+    }
+    uint8_t frame[INPUT_FRAME_SIZE];
+    frame[0] = (move + 1) | (rotate + 1) << 2;
+    const float values[4] = {seconds, game.playerX, game.playerY,
+                             game.playerA};
+    memcpy(frame + 1, values, sizeof(values));
+    _failed = fwrite(frame, sizeof(frame), 1, _file) != 1;
+    _frames += !_failed;
+    return !_failed;
+}
+
+InputRecorder::~InputRecorder()
+{
+    fclose(_file);
+}
+
+std::unique_ptr<InputReplay> InputReplay::Open(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+    std::unique_ptr<InputReplay> replay(new InputReplay());
+    InputHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != INPUT_LOG_MAGIC ||
+        header.version != INPUT_LOG_VERSION) {
+        fclose(file);
+        return nullptr;
+    }
+    replay->_startX = header.playerX;
+    replay->_startY = header.playerY;
+    replay->_startA = header.playerA;
+
+    // a frame cut short by a crash while recording is dropped
+    uint8_t frame[INPUT_FRAME_SIZE];
+    while (fread(frame, sizeof(frame), 1, file) == 1) {
+        float values[4];
+        memcpy(values, frame + 1, sizeof(values));
+        replay->_frames.push_back({static_cast<int8_t>((frame[0] & 3) - 1),
+                                   static_cast<int8_t>((frame[0] >> 2) - 1),
+                                   values[0], values[1], values[2],
+                                   values[3]});
+    }
+    fclose(file);
+    return replay;
+}
+
+void InputReplay::Reset(Game *game) const
+{
+    game->playerX = _startX;
+    game->playerY = _startY;
+    game->playerA = _startA;
+    for (int door = 0; door < DOOR_COUNT; door++) {
+        game->doors.SetOpen(door, 0);
+    }
+}
+
+void InputReplay::Step(Game *game, size_t i)
+{
+    const InputFrame &f = _frames[i];
+    game->Move(f.move, f.rotate, f.seconds);
+    if (game->playerX != f.playerX || game->playerY != f.playerY ||
+        game->playerA != f.playerA) {
+        game->playerX = f.playerX;
+        game->playerY = f.playerY;
+        game->playerA = f.playerA;
+        _drifted++;
+    }
+}
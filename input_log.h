@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include "game.h"
+
+// in host byte order: a header of the magic, version and starting pose,
+// then INPUT_FRAME_SIZE bytes per frame, the keys as (move + 1) |
+// (rotate + 1) << 2 and then the time step, playerX, playerY and playerA
+// as floats
+#define INPUT_LOG_MAGIC 0x4e494352
+#define INPUT_LOG_VERSION 1
+#define INPUT_FRAME_SIZE 17
+
+// one frame of a session: the keys Game::Move was given, the time step it
+// took them over and the pose it left the player in
+struct InputFrame {
+    int8_t move;
+    int8_t rotate;
+    float seconds;
+    float playerX;
+    float playerY;
+    float playerA;
+};
+
+// logs the frames of a session as they are played
+class InputRecorder
+{
+public:
+    // the session starts from game as it is now; nullptr if path can't be
+    // created
+    static std::unique_ptr<InputRecorder> Open(const char *path,
+                                               const Game &game);
+
+    // after game.Move(move, rotate, seconds); false once a write failed
+    bool Add(int move, int rotate, float seconds, const Game &game);
+    uint64_t Frames() const { return _frames; }
+
+    // flushes and closes the log
+    ~InputRecorder();
+
+private:
+    explicit InputRecorder(FILE *file) : _file(file) {}
+
+    FILE *_file;
+    bool _failed = false;
+    uint64_t _frames = 0;
+};
+
+// a recorded session, read whole, to play the same frames again at the
+// recorded time steps however long each one takes to render
+class InputReplay
+{
+public:
+    // nullptr if path can't be read or is not an input log
+    static std::unique_ptr<InputReplay> Open(const char *path);
+
+    // game as the session started, doors shut
+    void Reset(Game *game) const;
+    // frame i of the session onto game through Game::Move. Should this
+    // build's arithmetic stray from the recorded pose the player is put
+    // back on it, so every build renders the same frames; Drifted counts
+    // those
+    void Step(Game *game, size_t i);
+    const std::vector<InputFrame> &Frames() const { return _frames; }
+    uint64_t Drifted() const { return _drifted; }
+
+private:
+    InputReplay() {}
+
+    float _startX;
+    float _startY;
+    float _startA;
+    std::vector<InputFrame> _frames;
+    uint64_t _drifted = 0;
+};
@@ -2,68 +2,136 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "frame_pipeline.h"
 #include "game.h"
+#include "input_log.h"
+#include "profiler.h"
 #include "raycaster.h"
+#include "raycaster_baked.h"
 #include "raycaster_fixed.h"
 #include "raycaster_float.h"
+#include "raycaster_map.h"
 #include "renderer.h"
+#include "resolution_governor.h"
+#include "thread_pool.h"
 
 using namespace std;
 
-class fps_renderer
+// lines of text in the top left corner, the fps and with RAYCASTER_PROFILE
+// where the frame time goes
+class stats_renderer
 {
 public:
-    fps_renderer(SDL_Renderer *renderer) : renderer(renderer)
+    stats_renderer(SDL_Renderer *renderer) : renderer(renderer)
     {
-        font = TTF_OpenFont("FreeMono.ttf", 24);
-        loc.x = 0;
-        loc.y = 0;
+        // the breakdown takes a smaller font than the fps alone
+        font = TTF_OpenFont("FreeMono.ttf", Profiler::Enabled() ? 12 : 24);
     }
 
-    ~fps_renderer() { SDL_DestroyTexture(texture); }
+    ~stats_renderer() { clear(); }
 
-    void update(int fps)
+    void update(const vector<string> &lines)
     {
-        if (fps != _fps) {
-            _fps = fps;
-            update_texture();
+        if (lines == _lines) {
+            return;
+        }
+        _lines = lines;
+        clear();
+        int y = 0;
+        for (const auto &line : lines) {
+            auto surf =
+                TTF_RenderText_Solid(font, line.c_str(), {0, 0, 255});
+            if (surf == nullptr) {
+                continue;
+            }
+            SDL_Rect loc = {0, y, 0, 0};
+            auto texture = SDL_CreateTextureFromSurface(renderer, surf);
+            SDL_QueryTexture(texture, 0, 0, &loc.w, &loc.h);
+            SDL_FreeSurface(surf);
+            textures.push_back({texture, loc});
+            y += loc.h;
         }
     }
 
-    void render() { SDL_RenderCopy(renderer, texture, NULL, &loc); }
+    void render()
+    {
+        for (const auto &t : textures) {
+            SDL_RenderCopy(renderer, t.first, NULL, &t.second);
+        }
+    }
 
 private:
-    void update_texture()
+    void clear()
     {
-        const auto text = std::to_string(_fps);
-        auto surf = TTF_RenderText_Solid(font, text.c_str(), {0, 0, 255});
-        SDL_DestroyTexture(texture);
-        texture = SDL_CreateTextureFromSurface(renderer, surf);
-        SDL_QueryTexture(texture, 0, 0, &loc.w, &loc.h);
-        SDL_FreeSurface(surf);
+        for (const auto &t : textures) {
+            SDL_DestroyTexture(t.first);
+        }
+        textures.clear();
     }
     SDL_Renderer *renderer;
     TTF_Font *font;
-    int _fps = 0;
-    SDL_Texture *texture = nullptr;
-    SDL_Rect loc;
+    vector<string> _lines;
+    vector<pair<SDL_Texture *, SDL_Rect>> textures;
 };
 
-static void DrawBuffer(SDL_Renderer *sdlRenderer,
-                       SDL_Texture *sdlTexture,
-                       uint32_t *fb,
-                       int dx)
+// milliseconds per frame of each zone, summed over the threads, and the
+// counters per frame between two snapshots
+static vector<string> Breakdown(const Profiler::Snapshot &from,
+                                const Profiler::Snapshot &to,
+                                int frames)
+{
+    vector<string> lines;
+    char line[64];
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        const auto zone = static_cast<ProfileZone>(z);
+        snprintf(line, sizeof(line), "%-9s %6.2f ms", Profiler::Name(zone),
+                 (to.time[z] - from.time[z]) / 1e6 / frames);
+        lines.push_back(line);
+    }
+    const uint64_t columns =
+        to.counts[PROFILE_COLUMNS] - from.counts[PROFILE_COLUMNS];
+    snprintf(line, sizeof(line), "steps/column %.2f",
+             columns > 0 ? static_cast<double>(
+                               to.counts[PROFILE_DDA_STEPS] -
+                               from.counts[PROFILE_DDA_STEPS]) /
+                               columns
+                         : 0.0);
+    lines.push_back(line);
+    for (int c = PROFILE_DDA_STEPS; c < PROFILE_COUNTER_COUNT; c++) {
+        const auto counter = static_cast<ProfileCounter>(c);
+        snprintf(line, sizeof(line), "%s/frame %.0f", Profiler::Name(counter),
+                 static_cast<double>(to.counts[c] - from.counts[c]) / frames);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// the texture's memory until DrawTexture, frames are traced straight into it
+static RenderTarget<uint32_t> LockTexture(SDL_Texture *sdlTexture)
 {
     int pitch = 0;
     void *pixelsPtr;
     if (SDL_LockTexture(sdlTexture, NULL, &pixelsPtr, &pitch)) {
         throw runtime_error("Unable to lock texture");
     }
-    memcpy(pixelsPtr, fb, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    return {static_cast<uint32_t *>(pixelsPtr), static_cast<size_t>(pitch)};
+}
+
+static void DrawTexture(SDL_Renderer *sdlRenderer,
+                        SDL_Texture *sdlTexture,
+                        int dx)
+{
     SDL_UnlockTexture(sdlTexture);
     SDL_Rect r;
     r.x = dx * SCREEN_SCALE;
@@ -73,6 +141,21 @@ static void DrawBuffer(SDL_Renderer *sdlRenderer,
     SDL_RenderCopy(sdlRenderer, sdlTexture, NULL, &r);
 }
 
+// a frame traced elsewhere, copied in row by row
+static void DrawBuffer(SDL_Renderer *sdlRenderer,
+                       SDL_Texture *sdlTexture,
+                       const uint32_t *fb,
+                       int dx)
+{
+    const RenderTarget<uint32_t> target = LockTexture(sdlTexture);
+    auto *rows = reinterpret_cast<uint8_t *>(target.pixels);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        memcpy(rows + y * target.pitch, fb + y * SCREEN_WIDTH,
+               SCREEN_WIDTH * sizeof(uint32_t));
+    }
+    DrawTexture(sdlRenderer, sdlTexture, dx);
+}
+
 static bool ProcessEvent(const SDL_Event &event,
                          int *moveDirection,
                          int *rotateDirection)
@@ -107,6 +190,77 @@ static bool ProcessEvent(const SDL_Event &event,
 }
 int main(int argc, char *args[])
 {
+    // -b <milliseconds>: scale the traced columns to hold a frame budget
+    // -t <hits.bin>: render the fixed-point side from a baked hit table
+    // -c: fill column-major frames and transpose them
+    // -f: textured floor and ceiling
+    // -i: render 8-bit indexed frames, expanded to ARGB for drawing
+    // -d <tiles>: fade to fog over this distance
+    // -s <count>: scatter sprites over the map
+    // -p: trace the next frame while the last one is presented
+    // -o <trace.json>: record a Chrome trace, built with RAYCASTER_PROFILE
+    // -r <session.log>: record the keys and time steps of every frame
+    // -R <session.log>: replay a recorded session as fast as it renders
+    float budget = 0;
+    Shading shading;
+    uint32_t spriteCount = 0;
+    unique_ptr<RayCasterBaked> bakedCaster;
+    bool columnMajor = false;
+    bool texturedFloor = false;
+    bool indexed = false;
+    bool pipelined = false;
+    const char *tracePath = nullptr;
+    unique_ptr<InputRecorder> recorder;
+    unique_ptr<InputReplay> replay;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-c")) {
+            columnMajor = true;
+        } else if (!strcmp(args[i], "-f")) {
+            texturedFloor = true;
+        } else if (!strcmp(args[i], "-i")) {
+            indexed = true;
+        } else if (!strcmp(args[i], "-p")) {
+            pipelined = true;
+        } else if (i + 1 == argc) {
+            break;
+        } else if (!strcmp(args[i], "-d")) {
+            shading.SetFog(FOG_COLOUR, atof(args[++i]));
+        } else if (!strcmp(args[i], "-s")) {
+            spriteCount = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-b")) {
+            budget = atof(args[++i]) / 1000.0f;
+        } else if (!strcmp(args[i], "-o")) {
+            tracePath = args[++i];
+        } else if (!strcmp(args[i], "-r")) {
+            recorder = InputRecorder::Open(args[++i], Game());
+            if (!recorder) {
+                perror(args[i]);
+                return 1;
+            }
+        } else if (!strcmp(args[i], "-R")) {
+            replay = InputReplay::Open(args[++i]);
+            if (!replay) {
+                printf("%s is not an input log\n", args[i]);
+                return 1;
+            }
+        } else if (!strcmp(args[i], "-t")) {
+            bakedCaster = RayCasterBaked::Open(args[++i]);
+            if (!bakedCaster) {
+                printf("%s is not a hit table for this map\n", args[i]);
+                return 1;
+            }
+        }
+    }
+
+    if (tracePath && !Profiler::Enabled()) {
+        printf("-o needs a build with RAYCASTER_PROFILE\n");
+        return 1;
+    }
+    if (tracePath && !Profiler::OpenTrace(tracePath)) {
+        perror(tracePath);
+        return 1;
+    }
+
     if ((SDL_Init(SDL_INIT_VIDEO) < 0) || (TTF_Init() < 0)) {
         printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
     } else {
@@ -121,12 +275,44 @@ int main(int argc, char *args[])
                    SDL_GetError());
         } else {
             Game game;
+            ThreadPool pool(std::thread::hardware_concurrency());
             RayCasterFloat floatCaster;
-            Renderer floatRenderer(&floatCaster);
-            uint32_t floatBuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+            Renderer floatRenderer(&floatCaster, &pool);
             RayCasterFixed fixedCaster;
-            Renderer fixedRenderer(&fixedCaster);
-            uint32_t fixedBuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+            RayCaster *leftCaster = &fixedCaster;
+            if (bakedCaster) {
+                leftCaster = bakedCaster.get();
+            }
+            Renderer fixedRenderer(leftCaster, &pool);
+            vector<uint8_t> floatIndexed(indexed ? SCREEN_WIDTH * SCREEN_HEIGHT
+                                                 : 0);
+            vector<uint8_t> fixedIndexed(floatIndexed.size());
+            ResolutionGovernor floatGovernor(budget);
+            ResolutionGovernor fixedGovernor(budget);
+            floatRenderer.SetColumnMajor(columnMajor);
+            fixedRenderer.SetColumnMajor(columnMajor);
+            floatRenderer.SetTexturedFloor(texturedFloor);
+            fixedRenderer.SetTexturedFloor(texturedFloor);
+            floatRenderer.SetShading(&shading);
+            fixedRenderer.SetShading(&shading);
+            // orbs, stored past the wall materials
+            const uint8_t orb = MATERIAL_COUNT;
+            uint8_t orbTexels[TEXTURE_SIZE * TEXTURE_SIZE];
+            SpriteOrb(orbTexels);
+            TextureAtlas atlas;
+            atlas.SetTexture(orb, orbTexels);
+            SpriteGrid sprites(MAP_X, MAP_Y);
+            ScatterSprites(&sprites, spriteCount, orb, 1);
+            if (spriteCount > 0) {
+                floatRenderer.SetAtlas(&atlas);
+                fixedRenderer.SetAtlas(&atlas);
+                floatRenderer.SetSprites(&sprites);
+                fixedRenderer.SetSprites(&sprites);
+            }
+            if (budget > 0) {
+                floatRenderer.SetGovernor(&floatGovernor);
+                fixedRenderer.SetGovernor(&fixedGovernor);
+            }
             int moveDirection = 0;
             int rotateDirection = 0;
             bool isExiting = false;
@@ -145,29 +331,144 @@ int main(int argc, char *args[])
                 sdlRenderer, SDL_PIXELFORMAT_ARGB8888,
                 SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-            fps_renderer fps(sdlRenderer);
+            stats_renderer stats(sdlRenderer);
+            auto profiled = Profiler::Read();
 
             auto count2sec = [=](auto start, auto end) {
                 return (end - start) / static_cast<float>(tickFrequency);
             };
 
+            // both views in one batch, sharing the pool
+            const auto traceViews = [&](const RenderTarget<uint32_t> &fixedFb,
+                                        const RenderTarget<uint32_t> &floatFb) {
+                if (indexed) {
+                    const RenderTarget<uint8_t> floatTarget = {
+                        floatIndexed.data()};
+                    const RenderTarget<uint8_t> fixedTarget = {
+                        fixedIndexed.data()};
+                    const Camera<uint8_t> cameras[2] = {
+                        {&floatRenderer, game.playerX, game.playerY,
+                         game.playerA, floatTarget},
+                        {&fixedRenderer, game.playerX, game.playerY,
+                         game.playerA, fixedTarget}};
+                    Renderer::TraceFrames(&game, cameras, 2, &pool);
+                    Renderer::ExpandIndexed(floatTarget, floatFb);
+                    Renderer::ExpandIndexed(fixedTarget, fixedFb);
+                } else {
+                    const Camera<uint32_t> cameras[2] = {
+                        {&floatRenderer, game.playerX, game.playerY,
+                         game.playerA, floatFb},
+                        {&fixedRenderer, game.playerX, game.playerY,
+                         game.playerA, fixedFb}};
+                    Renderer::TraceFrames(&game, cameras, 2, &pool);
+                }
+            };
+
+            // one frame of play, the keys over seconds or the next frame of
+            // the replay; false once the replay is over
+            size_t replayed = 0;
+            if (replay) {
+                replay->Reset(&game);
+            }
+            const auto advance = [&](int move, int rotate, float seconds) {
+                if (replay) {
+                    if (replayed == replay->Frames().size()) {
+                        return false;
+                    }
+                    replay->Step(&game, replayed++);
+                    return true;
+                }
+                game.Move(move, rotate, seconds);
+                if (recorder) {
+                    recorder->Add(move, rotate, seconds, game);
+                }
+                return true;
+            };
+            const auto replayStart = chrono::steady_clock::now();
+
+            // pipelined, the game belongs to the tracing thread and only
+            // sees the keys through these
+            atomic<int> moveInput{0};
+            atomic<int> rotateInput{0};
+            atomic<bool> replayDone{false};
+            auto moved = chrono::steady_clock::now();
+            unique_ptr<FramePipeline> pipeline;
+            if (pipelined) {
+                pipeline.reset(new FramePipeline(
+                    2 * SCREEN_WIDTH * SCREEN_HEIGHT, [&](uint32_t *pixels) {
+                        const auto now = chrono::steady_clock::now();
+                        if (!advance(moveInput, rotateInput,
+                                     chrono::duration<float>(now - moved)
+                                         .count())) {
+                            replayDone = true;
+                        }
+                        moved = now;
+                        traceViews({pixels},
+                                   {pixels + SCREEN_WIDTH * SCREEN_HEIGHT});
+                    }));
+            }
+
             while (!isExiting) {
                 ++framecount;
-                floatRenderer.TraceFrame(&game, floatBuffer);
-                fixedRenderer.TraceFrame(&game, fixedBuffer);
-
-                DrawBuffer(sdlRenderer, fixedTexture, fixedBuffer, 0);
-                DrawBuffer(sdlRenderer, floatTexture, floatBuffer,
-                           SCREEN_WIDTH + 1);
+                if (pipeline) {
+                    const PipelineFrame &frame = pipeline->Acquire();
+                    PROFILE_SCOPE(PROFILE_DRAW);
+                    DrawBuffer(sdlRenderer, fixedTexture, frame.pixels.data(),
+                               0);
+                    DrawBuffer(sdlRenderer, floatTexture,
+                               frame.pixels.data() +
+                                   SCREEN_WIDTH * SCREEN_HEIGHT,
+                               SCREEN_WIDTH + 1);
+                } else {
+                    traceViews(LockTexture(fixedTexture),
+                               LockTexture(floatTexture));
+                    PROFILE_SCOPE(PROFILE_DRAW);
+                    DrawTexture(sdlRenderer, fixedTexture, 0);
+                    DrawTexture(sdlRenderer, floatTexture, SCREEN_WIDTH + 1);
+                }
                 if (count2sec(fpsCounter, SDL_GetPerformanceCounter()) >=
                     1.0f) {
                     auto n = SDL_GetPerformanceCounter();
-                    fps.update(framecount / count2sec(fpsCounter, n));
+                    vector<string> lines = {
+                        to_string(static_cast<int>(
+                            framecount / count2sec(fpsCounter, n))) +
+                        " fps"};
+                    if (Profiler::Enabled()) {
+                        const auto now = Profiler::Read();
+                        const auto zones =
+                            Breakdown(profiled, now, framecount);
+                        lines.insert(lines.end(), zones.begin(), zones.end());
+                        profiled = now;
+                    }
+                    stats.update(lines);
+                    if (budget > 0) {
+                        printf("scale fixed %.2f float %.2f, budget miss "
+                               "rate fixed %.1f%% float %.1f%%\n",
+                               fixedGovernor.Scale(), floatGovernor.Scale(),
+                               fixedGovernor.MissRate() * 100.0f,
+                               floatGovernor.MissRate() * 100.0f);
+                    }
+                    if (pipeline) {
+                        printf("pipeline busy trace %.0f%% present %.0f%%, "
+                               "latency %.1f ms of which %.1f ms queued\n",
+                               pipeline->TraceOccupancy() * 100.0f,
+                               pipeline->PresentOccupancy() * 100.0f,
+                               pipeline->Latency() * 1000.0f,
+                               pipeline->QueueLatency() * 1000.0f);
+                        pipeline->ResetStats();
+                    }
                     fpsCounter = n;
                     framecount = 0;
                 }
-                fps.render();
-                SDL_RenderPresent(sdlRenderer);
+                stats.render();
+                {
+                    PROFILE_SCOPE(PROFILE_PRESENT);
+                    SDL_RenderPresent(sdlRenderer);
+                }
+                Profiler::EndFrame();
+                if (pipeline) {
+                    pipeline->Release();
+                }
 
                 if (SDL_PollEvent(&event)) {
                     isExiting =
@@ -176,7 +477,24 @@ int main(int argc, char *args[])
                 const auto nextCounter = SDL_GetPerformanceCounter();
                 const auto seconds = count2sec(tickCounter, nextCounter);
                 tickCounter = nextCounter;
-                game.Move(moveDirection, rotateDirection, seconds);
+                if (pipeline) {
+                    moveInput = moveDirection;
+                    rotateInput = rotateDirection;
+                    isExiting |= replayDone;
+                } else if (!advance(moveDirection, rotateDirection,
+                                    seconds)) {
+                    isExiting = true;
+                }
+            }
+            // stop tracing before anything it uses goes away
+            pipeline.reset();
+            if (replay) {
+                const chrono::duration<double> elapsed =
+                    chrono::steady_clock::now() - replayStart;
+                printf("replayed %zu frames in %.2f s: %.1f frames/s, %llu "
+                       "put back on the recorded pose\n",
+                       replayed, elapsed.count(), replayed / elapsed.count(),
+                       static_cast<unsigned long long>(replay->Drifted()));
             }
             SDL_DestroyTexture(floatTexture);
             SDL_DestroyTexture(fixedTexture);
@@ -186,5 +504,6 @@ int main(int argc, char *args[])
     }
 
     SDL_Quit();
+    Profiler::CloseTrace();
     return 0;
 }
@@ -0,0 +1,335 @@
+// kernel microbenchmarks for the fixed-point primitives and the float DDA
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "perf_counters.h"
+#include "raycaster_fixed_kernels.h"
+#include "raycaster_float.h"
+
+using namespace std;
+
+struct KernelResult {
+    const char *name;
+    uint64_t calls;
+    double ns;
+    PerfCounters::Sample counters;
+};
+
+static volatile uint32_t g_sink;
+
+// hide a value from the optimizer so pure kernels cannot be folded or
+// hoisted out of the measured loops
+template <typename T>
+static inline T Opaque(T v)
+{
+    asm volatile("" : "+r"(v));
+    return v;
+}
+
+// body() makes `calls` kernel calls and returns a value to keep them alive
+template <typename F>
+static KernelResult Measure(const char *name,
+                            PerfCounters *perf,
+                            uint64_t calls,
+                            int repeat,
+                            F &&body)
+{
+    g_sink = g_sink + body();
+
+    uint32_t sink = 0;
+    perf->Start();
+    const auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        sink += body();
+    }
+    const auto end = chrono::steady_clock::now();
+    KernelResult res;
+    res.counters = perf->Stop();
+    g_sink = g_sink + sink;
+
+    res.name = name;
+    res.calls = calls * repeat;
+    res.ns = chrono::duration<double, nano>(end - start).count();
+    return res;
+}
+
+struct Ray {
+    uint16_t x;
+    uint16_t y;
+    uint16_t a;
+};
+
+// 4x4 sub-tile positions in every open tile of an 8x8 tile grid, crossed
+// with all 1024 angles
+static vector<Ray> MakeRays()
+{
+    vector<Ray> rays;
+    for (int ty = 2; ty < MAP_Y; ty += 4) {
+        for (int tx = 2; tx < MAP_X; tx += 4) {
+            if (IsWall(tx, ty)) {
+                continue;
+            }
+            for (int sy = 32; sy < 256; sy += 64) {
+                for (int sx = 32; sx < 256; sx += 64) {
+                    for (int a = 0; a < 1024; a++) {
+                        rays.push_back({static_cast<uint16_t>((tx << 8) + sx),
+                                        static_cast<uint16_t>((ty << 8) + sy),
+                                        NeutralizeAngle(a)});
+                    }
+                }
+            }
+        }
+    }
+    return rays;
+}
+
+static void Print(const KernelResult &r, bool perf)
+{
+    const double n = static_cast<double>(r.calls);
+    printf("%-34s %12llu %9.2f", r.name,
+           static_cast<unsigned long long>(r.calls), r.ns / n);
+    if (perf) {
+        for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++) {
+            if (r.counters.valid[c]) {
+                printf(" %12.3f", r.counters.value[c] / n);
+            } else {
+                printf(" %12s", "-");
+            }
+        }
+    }
+    printf("\n");
+}
+
+static void WriteJson(FILE *f, const vector<KernelResult> &results)
+{
+    fprintf(f, "{\n  \"kernels\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        const double n = static_cast<double>(r.calls);
+        fprintf(f,
+                "    {\"name\": \"%s\", \"calls\": %llu, "
+                "\"ns_per_call\": %.4f",
+                r.name, static_cast<unsigned long long>(r.calls), r.ns / n);
+        for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++) {
+            if (r.counters.valid[c]) {
+                const auto counter = static_cast<PerfCounters::Counter>(c);
+                fprintf(f, ", \"%s_per_call\": %.4f",
+                        PerfCounters::Name(counter), r.counters.value[c] / n);
+            }
+        }
+        fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char *args[])
+{
+    int repeat = 8;
+    const char *jsonPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-r") && i + 1 < argc) {
+            repeat = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-o") && i + 1 < argc) {
+            jsonPath = args[++i];
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-r repeat] [-o results.json]\n"
+                    "  -r  passes over each input set (default 8)\n"
+                    "  -o  write machine-readable results\n",
+                    args[0]);
+            return 1;
+        }
+    }
+    if (repeat <= 0) {
+        repeat = 1;
+    }
+
+    PerfCounters perf;
+    if (!perf.Available()) {
+        fprintf(stderr,
+                "perf_event_open unavailable, reporting time only (check "
+                "/proc/sys/kernel/perf_event_paranoid)\n");
+    }
+
+    const auto rays = MakeRays();
+    auto shuffled = rays;
+    shuffle(shuffled.begin(), shuffled.end(), mt19937(1));
+
+    vector<KernelResult> results;
+
+    results.push_back(Measure("MulU", &perf, 256 * 256, repeat, [] {
+        uint32_t sum = 0;
+        for (int a = 0; a < 256; a++) {
+            const uint16_t f = g_tan[a];
+            for (int v = 0; v < 256; v++) {
+                sum += MulU(Opaque<uint8_t>(v), f);
+            }
+        }
+        return sum;
+    }));
+
+    results.push_back(Measure("MulS", &perf, 256 * 256, repeat, [] {
+        uint32_t sum = 0;
+        for (int d = -128; d < 128; d++) {
+            const int16_t f = d * 32;
+            for (int v = 0; v < 256; v++) {
+                sum += MulS(Opaque<uint8_t>(v), f);
+            }
+        }
+        return sum;
+    }));
+
+    results.push_back(Measure("MulTan", &perf, 1024 * 16 * 2, repeat, [] {
+        uint32_t sum = 0;
+        for (int a = 0; a < 1024; a++) {
+            for (int v = 0; v < 256; v += 16) {
+                const uint8_t value = Opaque<uint8_t>(v);
+                sum += MulTan(value, true, a >> 8, a % 256, g_tan);
+                sum += MulTan(value, false, a >> 8, a % 256, g_cotan);
+            }
+        }
+        return sum;
+    }));
+
+    results.push_back(Measure("AbsTan", &perf, 1024 * 2, repeat, [] {
+        uint32_t sum = 0;
+        for (int i = 0; i < 1024; i++) {
+            const int a = Opaque(i);
+            sum += AbsTan(a >> 8, a % 256, g_tan);
+            sum += AbsTan(a >> 8, a % 256, g_cotan);
+        }
+        return sum;
+    }));
+
+    results.push_back(Measure("LookupHeight", &perf, 4096, repeat, [] {
+        uint32_t sum = 0;
+        for (int d = 0; d < 4096; d++) {
+            uint8_t height;
+            uint16_t step;
+            LookupHeight(Opaque<uint16_t>(d), &height, &step);
+            sum += height + step;
+        }
+        return sum;
+    }));
+
+    results.push_back(Measure("IsWall", &perf, 34 * 34, repeat * 64, [] {
+        uint32_t sum = 0;
+        for (int y = -1; y <= MAP_Y; y++) {
+            for (int x = -1; x <= MAP_X; x++) {
+                sum += IsWall(Opaque<uint8_t>(x), y);
+            }
+        }
+        return sum;
+    }));
+
+    auto castFixed = [](const vector<Ray> &input) {
+        return [&input] {
+            uint32_t sum = 0;
+            for (const auto &r : input) {
+                int16_t deltaX;
+                int16_t deltaY;
+                uint8_t textureNo;
+                uint8_t textureX;
+                CalculateDistance(Opaque(r.x), r.y, r.a, &deltaX, &deltaY,
+                                  &textureNo, &textureX);
+                sum += deltaX + deltaY + textureNo + textureX;
+            }
+            return sum;
+        };
+    };
+    results.push_back(Measure("CalculateDistance", &perf, rays.size(), repeat,
+                              castFixed(rays)));
+    results.push_back(Measure("CalculateDistance/shuffled", &perf,
+                              shuffled.size(), repeat, castFixed(shuffled)));
+
+    // quarter-specialized traversal, dispatched once per ray
+    auto castQuarter = [](const vector<Ray> &input) {
+        return [&input] {
+            uint32_t sum = 0;
+            for (const auto &r : input) {
+                int16_t deltaX;
+                int16_t deltaY;
+                uint8_t textureNo;
+                uint8_t textureX;
+                uint8_t material;
+                const uint16_t x = Opaque(r.x);
+                switch (r.a >> 8) {
+                case 0:
+                    CalculateDistance<0>(x, r.y, r.a % 256, &deltaX, &deltaY,
+                                         &textureNo, &textureX, &material);
+                    break;
+                case 1:
+                    CalculateDistance<1>(x, r.y, r.a % 256, &deltaX, &deltaY,
+                                         &textureNo, &textureX, &material);
+                    break;
+                case 2:
+                    CalculateDistance<2>(x, r.y, r.a % 256, &deltaX, &deltaY,
+                                         &textureNo, &textureX, &material);
+                    break;
+                default:
+                    CalculateDistance<3>(x, r.y, r.a % 256, &deltaX, &deltaY,
+                                         &textureNo, &textureX, &material);
+                    break;
+                }
+                sum += deltaX + deltaY + textureNo + textureX + material;
+            }
+            return sum;
+        };
+    };
+    results.push_back(Measure("CalculateDistance<Q>", &perf, rays.size(),
+                              repeat, castQuarter(rays)));
+    results.push_back(Measure("CalculateDistance<Q>/shuffled", &perf,
+                              shuffled.size(), repeat, castQuarter(shuffled)));
+
+    RayCasterFloat floatCaster;
+    auto castFloat = [&floatCaster](const vector<Ray> &input) {
+        return [&floatCaster, &input] {
+            uint32_t sum = 0;
+            for (const auto &r : input) {
+                float hitOffset;
+                int hitDirection;
+                uint8_t material;
+                const float d = floatCaster.Distance(
+                    r.x / 256.0f, r.y / 256.0f, r.a * 2.0f * M_PI / 1024.0f,
+                    &hitOffset, &hitDirection, &material);
+                sum += static_cast<uint32_t>(d * 256.0f) + hitDirection +
+                       material;
+            }
+            return sum;
+        };
+    };
+    results.push_back(Measure("RayCasterFloat::Distance", &perf, rays.size(),
+                              repeat, castFloat(rays)));
+    results.push_back(Measure("RayCasterFloat::Distance/shuffled", &perf,
+                              shuffled.size(), repeat, castFloat(shuffled)));
+
+    printf("%-34s %12s %9s", "kernel", "calls", "ns/call");
+    if (perf.Available()) {
+        for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++) {
+            printf(" %12s",
+                   PerfCounters::Name(static_cast<PerfCounters::Counter>(c)));
+        }
+    }
+    printf("\n");
+    for (const auto &r : results) {
+        Print(r, perf.Available());
+    }
+
+    if (jsonPath) {
+        FILE *f = fopen(jsonPath, "w");
+        if (!f) {
+            perror(jsonPath);
+            return 1;
+        }
+        WriteJson(f, results);
+        fclose(f);
+    }
+    return 0;
+}
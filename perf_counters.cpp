@@ -0,0 +1,132 @@
+#include "perf_counters.h"
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int OpenCounter(uint32_t type, uint64_t config, int group)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+    return static_cast<int>(
+        syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+PerfCounters::PerfCounters()
+{
+    const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        _fd[i] = OpenCounter(events[i].type, events[i].config, _leader);
+        if (_leader < 0) {
+            _leader = _fd[i];
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (_fd[i] >= 0) {
+            close(_fd[i]);
+        }
+    }
+}
+
+void PerfCounters::Start()
+{
+    if (_leader < 0) {
+        return;
+    }
+    ioctl(_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::Sample PerfCounters::Stop()
+{
+    Sample s;
+    memset(&s, 0, sizeof(s));
+    if (_leader < 0) {
+        return s;
+    }
+    ioctl(_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // PERF_FORMAT_GROUP | PERF_FORMAT_ID: nr, then {value, id} per event
+    uint64_t data[1 + 2 * COUNTER_COUNT];
+    if (read(_leader, data, sizeof(data)) < 0) {
+        return s;
+    }
+    uint64_t ids[COUNTER_COUNT];
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        ids[i] = ~0ULL;
+        if (_fd[i] >= 0) {
+            ioctl(_fd[i], PERF_EVENT_IOC_ID, &ids[i]);
+        }
+    }
+    for (uint64_t n = 0; n < data[0] && n < COUNTER_COUNT; n++) {
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            if (ids[i] == data[2 + 2 * n]) {
+                s.value[i] = data[1 + 2 * n];
+                s.valid[i] = true;
+            }
+        }
+    }
+    return s;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        _fd[i] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::Start() {}
+
+PerfCounters::Sample PerfCounters::Stop()
+{
+    Sample s;
+    memset(&s, 0, sizeof(s));
+    return s;
+}
+
+#endif  // __linux__
+
+const char *PerfCounters::Name(Counter c)
+{
+    switch (c) {
+    case CYCLES:
+        return "cycles";
+    case INSTRUCTIONS:
+        return "instructions";
+    case BRANCH_MISSES:
+        return "branch_misses";
+    case L1D_MISSES:
+        return "l1d_misses";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// hardware counters of the calling thread through perf_event_open; every
+// counter reads as unavailable on other platforms or when the kernel refuses
+class PerfCounters
+{
+public:
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,
+        COUNTER_COUNT
+    };
+
+    struct Sample {
+        uint64_t value[COUNTER_COUNT];
+        bool valid[COUNTER_COUNT];
+    };
+
+    static const char *Name(Counter c);
+
+    bool Available() const { return _leader >= 0; }
+    void Start();
+    Sample Stop();
+
+    PerfCounters();
+    ~PerfCounters();
+
+private:
+    int _fd[COUNTER_COUNT];
+    int _leader = -1;
+};
@@ -0,0 +1,140 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Profiler::_tracing{false};
+
+// threads stay registered, their totals count after they exit
+static std::mutex g_lock;
+static std::vector<ProfileThread *> g_threads;
+
+static FILE *g_trace;
+// trace timestamps count from the trace opening
+static uint64_t g_traceStart;
+static size_t g_named;
+static Profiler::Snapshot g_last;
+
+static const char *const g_zoneNames[PROFILE_ZONE_COUNT] = {
+    "Start", "Trace", "Fill", "Transpose", "Rows", "Sprites", "Draw",
+    "Present",
+};
+
+static const char *const g_counterNames[PROFILE_COUNTER_COUNT] = {
+    "columns",     "dda steps",  "door tests",
+    "sky pixels",  "wall pixels", "floor pixels",
+};
+
+const char *Profiler::Name(ProfileZone zone)
+{
+    return zone < PROFILE_ZONE_COUNT ? g_zoneNames[zone] : "";
+}
+
+const char *Profiler::Name(ProfileCounter counter)
+{
+    return counter < PROFILE_COUNTER_COUNT ? g_counterNames[counter] : "";
+}
+
+ProfileThread *Profiler::Register()
+{
+    ProfileThread *t = new ProfileThread();
+    std::lock_guard<std::mutex> lock(g_lock);
+    t->id = g_threads.size();
+    g_threads.push_back(t);
+    return t;
+}
+
+Profiler::Snapshot Profiler::Read()
+{
+    Snapshot s = {};
+    std::lock_guard<std::mutex> lock(g_lock);
+    for (const ProfileThread *t : g_threads) {
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+            s.time[z] += t->time[z].load(std::memory_order_relaxed);
+            s.calls[z] += t->calls[z].load(std::memory_order_relaxed);
+        }
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+            s.counts[c] += t->counts[c].load(std::memory_order_relaxed);
+        }
+        s.dropped += t->dropped.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+bool Profiler::OpenTrace(const char *path)
+{
+    CloseTrace();
+    FILE *f = fopen(path, "w");
+    if (f == nullptr) {
+        return false;
+    }
+    setvbuf(f, nullptr, _IOFBF, 1 << 20);
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    g_last = Read();
+    std::lock_guard<std::mutex> lock(g_lock);
+    g_trace = f;
+    g_traceStart = Now();
+    g_named = 0;
+    _tracing = true;
+    return true;
+}
+
+void Profiler::EndFrame()
+{
+    if (g_trace == nullptr) {
+        return;
+    }
+    const uint64_t now = Now();
+    const Snapshot s = Read();
+    std::lock_guard<std::mutex> lock(g_lock);
+    for (; g_named < g_threads.size(); g_named++) {
+        fprintf(g_trace,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                "\"tid\":%zu,\"args\":{\"name\":\"thread %zu\"}},\n",
+                g_named, g_named);
+    }
+    for (ProfileThread *t : g_threads) {
+        const uint32_t head = t->head.load(std::memory_order_acquire);
+        uint32_t tail = t->tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            const ProfileThread::Event &e = t->ring[tail % PROFILE_RING_SIZE];
+            // scopes that began before the trace opened start at 0
+            const uint64_t start =
+                e.start > g_traceStart ? e.start - g_traceStart : 0;
+            fprintf(g_trace,
+                    "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+                    "\"ts\":%.3f,\"dur\":%.3f},\n",
+                    g_zoneNames[e.zone], t->id, start / 1000.0,
+                    e.duration / 1000.0);
+        }
+        t->tail.store(tail, std::memory_order_release);
+    }
+    // the counters of the frame just ended
+    fprintf(g_trace, "{\"name\":\"frame\",\"ph\":\"C\",\"pid\":0,"
+                     "\"ts\":%.3f,\"args\":{",
+            (now - g_traceStart) / 1000.0);
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        fprintf(g_trace, "%s\"%s\":%llu", c > 0 ? "," : "",
+                g_counterNames[c],
+                static_cast<unsigned long long>(s.counts[c] -
+                                                g_last.counts[c]));
+    }
+    fputs("}},\n", g_trace);
+    g_last = s;
+}
+
+void Profiler::CloseTrace()
+{
+    if (g_trace == nullptr) {
+        return;
+    }
+    EndFrame();
+    _tracing = false;
+    std::lock_guard<std::mutex> lock(g_lock);
+    // the last event is followed by a comma, close with one more
+    fputs("{\"name\":\"end\",\"ph\":\"i\",\"pid\":0,\"tid\":0,\"ts\":0,"
+          "\"s\":\"g\"}\n]}\n",
+          g_trace);
+    fclose(g_trace);
+    g_trace = nullptr;
+}
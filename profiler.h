@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+// scoped timers and counters on the hot paths, built in with
+// -DRAYCASTER_PROFILE (cmake -DRAYCASTER_PROFILE=ON, make PROFILE=1).
+// Without it PROFILE_SCOPE and PROFILE_COUNT expand to nothing and the
+// Profiler reads all zeros
+
+enum ProfileZone {
+    PROFILE_START,      // RayCaster::Start of a camera
+    PROFILE_TRACE,      // TraceColumns of a band
+    PROFILE_FILL,       // sky, wall and flat floor fill of a band
+    PROFILE_TRANSPOSE,  // column-major blocks into the frame
+    PROFILE_ROWS,       // textured floor and ceiling rows
+    PROFILE_SPRITES,    // culling and drawing billboards
+    PROFILE_DRAW,       // frames into the window's textures
+    PROFILE_PRESENT,    // SDL_RenderPresent
+    PROFILE_ZONE_COUNT
+};
+
+enum ProfileCounter {
+    PROFILE_COLUMNS,      // rays traced
+    PROFILE_DDA_STEPS,    // traversal steps, a wall test each
+    PROFILE_DOOR_TESTS,   // door tiles the rays stopped at to test
+    PROFILE_SKY_PIXELS,   // flat sky (ceiling) filled by the column pass
+    PROFILE_WALL_PIXELS,  // wall texels filled
+    PROFILE_FLOOR_PIXELS, // flat floor filled by the column pass
+    PROFILE_COUNTER_COUNT
+};
+
+// events each thread keeps for the trace until EndFrame collects them;
+// more are dropped
+#define PROFILE_RING_SIZE 16384
+
+// per thread, written by its thread only
+struct ProfileThread {
+    struct Event {
+        uint64_t start;
+        uint32_t duration;
+        uint8_t zone;
+    };
+    uint32_t id;
+    std::atomic<uint64_t> time[PROFILE_ZONE_COUNT];
+    std::atomic<uint64_t> calls[PROFILE_ZONE_COUNT];
+    std::atomic<uint64_t> counts[PROFILE_COUNTER_COUNT];
+    // single producer ring, drained by EndFrame
+    Event ring[PROFILE_RING_SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// counted here between timers, published as the enclosing one ends
+inline thread_local uint64_t t_profileCounts[PROFILE_COUNTER_COUNT];
+inline thread_local ProfileThread *t_profileThread;
+
+class Profiler
+{
+public:
+    // totals over every thread since the start
+    struct Snapshot {
+        uint64_t time[PROFILE_ZONE_COUNT];
+        uint64_t calls[PROFILE_ZONE_COUNT];
+        uint64_t counts[PROFILE_COUNTER_COUNT];
+        uint64_t dropped;
+    };
+
+    static constexpr bool Enabled()
+    {
+#ifdef RAYCASTER_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+    static const char *Name(ProfileZone zone);
+    static const char *Name(ProfileCounter counter);
+
+    // from now on record every scope into a Chrome trace at path, for
+    // chrome://tracing or ui.perfetto.dev; false if it can't be created
+    static bool OpenTrace(const char *path);
+    // write out the events of all threads and this frame's counters. Call
+    // once per frame from one thread
+    static void EndFrame();
+    // finish the trace file
+    static void CloseTrace();
+    static Snapshot Read();
+
+    // steady clock nanoseconds
+    static uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void Record(ProfileZone zone, uint64_t start, uint64_t end)
+    {
+        ProfileThread *t = t_profileThread;
+        if (t == nullptr) {
+            t = t_profileThread = Register();
+        }
+        // one writer, plain loads and stores without a locked add
+        const auto add = [](std::atomic<uint64_t> &a, uint64_t n) {
+            a.store(a.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+        };
+        add(t->time[zone], end - start);
+        add(t->calls[zone], 1);
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+            if (t_profileCounts[c] != 0) {
+                add(t->counts[c], t_profileCounts[c]);
+                t_profileCounts[c] = 0;
+            }
+        }
+        if (!_tracing.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const uint32_t head = t->head.load(std::memory_order_relaxed);
+        if (head - t->tail.load(std::memory_order_acquire) ==
+            PROFILE_RING_SIZE) {
+            add(t->dropped, 1);
+            return;
+        }
+        t->ring[head % PROFILE_RING_SIZE] = {
+            start, static_cast<uint32_t>(end - start),
+            static_cast<uint8_t>(zone)};
+        t->head.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    static ProfileThread *Register();
+
+    static std::atomic<bool> _tracing;
+};
+
+// times its scope as zone
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileZone zone)
+        : _zone(zone), _start(Profiler::Now())
+    {
+    }
+    ~ProfileScope() { Profiler::Record(_zone, _start, Profiler::Now()); }
+
+private:
+    ProfileZone _zone;
+    uint64_t _start;
+};
+
+#ifdef RAYCASTER_PROFILE
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(zone) \
+    ProfileScope PROFILE_JOIN(profileScope, __LINE__)(zone)
+#define PROFILE_COUNT(counter, n) (t_profileCounts[counter] += (n))
+#else
+#define PROFILE_SCOPE(zone)
+#define PROFILE_COUNT(counter, n)
+#endif
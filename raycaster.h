@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <memory>
 
 /* specify the precalcuated tables */
 #define TABLES_320
@@ -19,20 +20,57 @@
 #define HORIZON_HEIGHT (SCREEN_HEIGHT / 2)
 #define INVERT(x) (uint8_t)((x ^ 255) + 1)
 
+class DoorMap;
+
 class RayCaster
 {
 public:
-    virtual void Start(uint16_t playerX, uint16_t playerY, int16_t playerA) = 0;
+    // (playerX, playerY) as 24.8 fixed point tiles, (playerA) full circle as
+    // 1024
+    virtual void Start(uint32_t playerX, uint32_t playerY, int16_t playerA) = 0;
     struct TraceResult {
         uint8_t screenY;
         uint8_t textureNo;
         uint8_t textureX;
         uint16_t textureY;
         uint16_t textureStep;
+        // material of the wall hit, see raycaster_map.h
+        uint8_t material;
+        // distance to the wall along the view direction, 8.8 fixed point
+        // tiles; 0xFFFF when nothing was hit
+        uint16_t distance;
     };
     virtual TraceResult Trace(uint16_t screenX) = 0;
 
+    // structure-of-arrays results, indexed by screenX
+    struct TraceBatch {
+        uint8_t screenY[SCREEN_WIDTH];
+        uint8_t textureNo[SCREEN_WIDTH];
+        uint8_t textureX[SCREEN_WIDTH];
+        uint16_t textureY[SCREEN_WIDTH];
+        uint16_t textureStep[SCREEN_WIDTH];
+        uint8_t material[SCREEN_WIDTH];
+        uint16_t distance[SCREEN_WIDTH];
+    };
+    // trace columns [first, first + count) using the state set by Start;
+    // safe to call concurrently for disjoint spans
+    virtual void TraceColumns(uint16_t first,
+                              uint16_t count,
+                              TraceBatch *out) const = 0;
+
+    // spread `columns` (at most SCREEN_WIDTH) rays over the field of view;
+    // screenX then ranges over [0, columns)
+    virtual void SetColumns(uint16_t columns) = 0;
+
+    // door state to trace against from the next Start on; casters without
+    // door support leave doorways open
+    virtual void SetDoors(const DoorMap *doors) {}
+
+    // a caster over the same map and tables with view state of its own, for
+    // tracing another camera alongside this one
+    virtual std::unique_ptr<RayCaster> Clone() const = 0;
+
     RayCaster(){};
 
-    ~RayCaster(){};
+    virtual ~RayCaster() = default;
 };
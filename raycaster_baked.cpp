@@ -0,0 +1,229 @@
+// fixed-point caster over a baked hit table
+
+#include "raycaster_baked.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include "door_map.h"
+#include "raycaster_fixed_kernels.h"
+
+uint64_t BakedMapHash()
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (auto tile : g_tiles) {
+        hash = (hash ^ tile) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// per-frame state, copied out of the caster so it stays in registers
+struct BakedFrame {
+    uint16_t playerX;
+    uint16_t playerY;
+    int16_t playerA;
+    uint8_t viewAngle;
+    const uint16_t *deltaAngle;
+    const uint16_t *cell;
+    const uint16_t *doors;
+};
+
+static inline uint16_t RayAngle(const BakedFrame &f, uint16_t screenX)
+{
+    return NeutralizeAngle(
+        static_cast<uint16_t>(f.playerA + f.deltaAngle[screenX]));
+}
+
+template <uint8_t Quarter, uint8_t ViewQuarter>
+static inline RayCaster::TraceResult TraceRay(const BakedFrame &f,
+                                              uint16_t rayAngle)
+{
+    RayCaster::TraceResult res;
+    int16_t deltaX;
+    int16_t deltaY;
+    const uint16_t hit = f.cell[rayAngle];
+    if (hit != BAKED_TRACE) {
+        res.textureNo = (hit >> BAKED_TEXTURE_SHIFT) & 1;
+        res.material = hit >> BAKED_MATERIAL_SHIFT;
+        ReplayHit<Quarter>(f.playerX, f.playerY, rayAngle % 256, hit & 0xFF,
+                           res.textureNo, &deltaX, &deltaY, &res.textureX);
+    } else {
+        CalculateDistance<Quarter>(f.playerX, f.playerY, rayAngle % 256,
+                                   &deltaX, &deltaY, &res.textureNo,
+                                   &res.textureX, &res.material, f.doors);
+    }
+
+    const int16_t distance =
+        ProjectDistance<ViewQuarter>(f.playerA, f.viewAngle, deltaX, deltaY);
+    res.distance = std::max<int16_t>(distance, 0);
+    if (distance >= MIN_DIST) {
+        res.textureY = 0;
+        LookupHeight((distance - MIN_DIST) >> 2, &res.screenY,
+                     &res.textureStep);
+    } else {
+        const int16_t d = std::max<int16_t>(distance, 0);
+        res.screenY = SCREEN_HEIGHT >> 1;
+        res.textureY = g_overflowOffset[d];
+        res.textureStep = g_overflowStep[d];
+    }
+    return res;
+}
+
+template <uint8_t ViewQuarter>
+static inline RayCaster::TraceResult TraceRay(const BakedFrame &f,
+                                              uint16_t screenX)
+{
+    const uint16_t rayAngle = RayAngle(f, screenX);
+    switch (rayAngle >> 8) {
+    case 0:
+        return TraceRay<0, ViewQuarter>(f, rayAngle);
+    case 1:
+        return TraceRay<1, ViewQuarter>(f, rayAngle);
+    case 2:
+        return TraceRay<2, ViewQuarter>(f, rayAngle);
+    default:
+        return TraceRay<3, ViewQuarter>(f, rayAngle);
+    }
+}
+
+template <uint8_t ViewQuarter>
+static void TraceSpan(const BakedFrame &f,
+                      uint16_t first,
+                      uint16_t count,
+                      RayCaster::TraceBatch *out)
+{
+    for (uint16_t x = first; x < first + count; x++) {
+        const auto res = TraceRay<ViewQuarter>(f, x);
+        out->screenY[x] = res.screenY;
+        out->textureNo[x] = res.textureNo;
+        out->textureX[x] = res.textureX;
+        out->textureY[x] = res.textureY;
+        out->textureStep[x] = res.textureStep;
+        out->material[x] = res.material;
+        out->distance[x] = res.distance;
+    }
+}
+
+RayCasterBaked::TraceResult RayCasterBaked::Trace(uint16_t screenX)
+{
+    const BakedFrame f = {_playerX,   _playerY,    _playerA,
+                          _viewAngle, _deltaAngle, _cell,
+                          _doors != nullptr ? _doors->OpenAmounts() : nullptr};
+    switch (_viewQuarter) {
+    case 0:
+        return TraceRay<0>(f, screenX);
+    case 1:
+        return TraceRay<1>(f, screenX);
+    case 2:
+        return TraceRay<2>(f, screenX);
+    default:
+        return TraceRay<3>(f, screenX);
+    }
+}
+
+void RayCasterBaked::TraceColumns(uint16_t first,
+                                  uint16_t count,
+                                  TraceBatch *out) const
+{
+    const BakedFrame f = {_playerX,   _playerY,    _playerA,
+                          _viewAngle, _deltaAngle, _cell,
+                          _doors != nullptr ? _doors->OpenAmounts() : nullptr};
+    switch (_viewQuarter) {
+    case 0:
+        TraceSpan<0>(f, first, count, out);
+        break;
+    case 1:
+        TraceSpan<1>(f, first, count, out);
+        break;
+    case 2:
+        TraceSpan<2>(f, first, count, out);
+        break;
+    default:
+        TraceSpan<3>(f, first, count, out);
+        break;
+    }
+}
+
+void RayCasterBaked::SetColumns(uint16_t columns)
+{
+    if (columns == _columns) {
+        return;
+    }
+    _columns = columns;
+    ColumnAngles(columns, _deltaAngle);
+}
+
+void RayCasterBaked::Start(uint32_t playerX, uint32_t playerY, int16_t playerA)
+{
+    playerA &= 1023;
+    _viewQuarter = playerA >> 8;
+    _viewAngle = playerA % 256;
+    _playerX = static_cast<uint16_t>(playerX);
+    _playerY = static_cast<uint16_t>(playerY);
+    _playerA = playerA;
+
+    const uint16_t gridX = std::min<uint32_t>(
+        _playerX >> (8 - _gridShift), _gridX - 1);
+    const uint16_t gridY = std::min<uint32_t>(
+        _playerY >> (8 - _gridShift), _gridY - 1);
+    _cell = _hits + (gridY * _gridX + gridX) * size_t(BAKED_ANGLES);
+}
+
+std::unique_ptr<RayCasterBaked> RayCasterBaked::Open(const char *path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < (off_t) sizeof(BakedHeader)) {
+        close(fd);
+        return nullptr;
+    }
+    const size_t size = st.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const auto *header = static_cast<const BakedHeader *>(data);
+    const size_t side = size_t(1) << header->gridShift;
+    if (header->magic != BAKED_MAGIC || header->version != BAKED_VERSION ||
+        header->gridShift > 7 || header->mapX != MAP_X ||
+        header->mapY != MAP_Y || header->mapHash != BakedMapHash() ||
+        size != sizeof(BakedHeader) + MAP_X * side * MAP_Y * side *
+                                          BAKED_ANGLES * sizeof(uint16_t)) {
+        munmap(data, size);
+        return nullptr;
+    }
+    const std::shared_ptr<const void> mapping(
+        data, [size](const void *data) {
+            munmap(const_cast<void *>(data), size);
+        });
+    return std::unique_ptr<RayCasterBaked>(new RayCasterBaked(mapping));
+}
+
+std::unique_ptr<RayCaster> RayCasterBaked::Clone() const
+{
+    std::unique_ptr<RayCasterBaked> clone(new RayCasterBaked(_mapping));
+    clone->SetColumns(_columns);
+    clone->SetDoors(_doors);
+    return clone;
+}
+
+RayCasterBaked::RayCasterBaked(std::shared_ptr<const void> mapping)
+    : RayCaster(), _mapping(mapping)
+{
+    const auto *header = static_cast<const BakedHeader *>(_mapping.get());
+    _hits = reinterpret_cast<const uint16_t *>(header + 1);
+    _gridShift = header->gridShift;
+    _gridX = MAP_X << _gridShift;
+    _gridY = MAP_Y << _gridShift;
+    _cell = _hits;
+    _columns = SCREEN_WIDTH;
+    ColumnAngles(SCREEN_WIDTH, _deltaAngle);
+}
+
+RayCasterBaked::~RayCasterBaked() {}
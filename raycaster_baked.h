@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include "raycaster.h"
+
+// hit table files, written by tools/hit_baker: a BakedHeader, then for each
+// grid cell (rows of x, from y = 0) one entry per ray angle, holding the
+// hit tile along the crossed axis, the textureNo and the material, or
+// BAKED_TRACE where rays from the cell see different walls or a door
+#define BAKED_MAGIC 0x54484352
+#define BAKED_VERSION 2
+#define BAKED_ANGLES 1024
+#define BAKED_TEXTURE_SHIFT 8
+#define BAKED_MATERIAL_SHIFT 9
+#define BAKED_TRACE 0xFFFF
+
+struct BakedHeader {
+    uint32_t magic;
+    uint16_t version;
+    // grid cells per tile side, as a shift of at most 7
+    uint8_t gridShift;
+    uint8_t reserved;
+    uint16_t mapX;
+    uint16_t mapY;
+    // FNV-1a of g_tiles, tables of another map are refused
+    uint64_t mapHash;
+};
+
+uint64_t BakedMapHash();
+
+// fixed-point caster answering rays from a memory-mapped hit table instead
+// of stepping through the map: the hit baked for the player's grid cell is
+// replayed from the actual position. Only the rays of cells that see more
+// than one wall are traced
+class RayCasterBaked : public RayCaster
+{
+public:
+    void Start(uint32_t playerX, uint32_t playerY, int16_t playerA) override;
+    TraceResult Trace(uint16_t screenX) override;
+    void TraceColumns(uint16_t first,
+                      uint16_t count,
+                      TraceBatch *out) const override;
+    void SetColumns(uint16_t columns) override;
+    void SetDoors(const DoorMap *doors) override { _doors = doors; }
+    std::unique_ptr<RayCaster> Clone() const override;
+
+    // nullptr if path can't be mapped or isn't a table for g_map
+    static std::unique_ptr<RayCasterBaked> Open(const char *path);
+    ~RayCasterBaked();
+
+private:
+    // the clones of a table share its mapping
+    explicit RayCasterBaked(std::shared_ptr<const void> mapping);
+
+    std::shared_ptr<const void> _mapping;
+    const uint16_t *_hits;
+    uint8_t _gridShift;
+    uint16_t _gridX;
+    uint16_t _gridY;
+    // the entries of the player's grid cell
+    const uint16_t *_cell;
+    uint16_t _playerX;
+    uint16_t _playerY;
+    int16_t _playerA;
+    uint8_t _viewQuarter;
+    uint8_t _viewAngle;
+    uint16_t _columns;
+    uint16_t _deltaAngle[SCREEN_WIDTH];
+    const DoorMap *_doors = nullptr;
+};
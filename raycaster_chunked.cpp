@@ -0,0 +1,446 @@
+// fixed-point implementation over a chunked map
+
+#include "raycaster_chunked.h"
+#include "raycaster_fixed_kernels.h"
+
+// walks the tiles of one ray, going back to the map only when the ray
+// crosses into another chunk
+class ChunkCursor
+{
+public:
+    uint8_t Occupancy(int32_t tileX, int32_t tileY)
+    {
+        return Fetch(tileX, tileY)
+            ->occupancy[((tileY & CHUNK_MASK) << CHUNK_SHIFT) +
+                        (tileX & CHUNK_MASK)];
+    }
+
+    uint8_t Material(int32_t tileX, int32_t tileY)
+    {
+        return Fetch(tileX, tileY)
+            ->tiles[((tileY & CHUNK_MASK) << CHUNK_SHIFT) +
+                    (tileX & CHUNK_MASK)];
+    }
+
+    ChunkCursor(ChunkMap *map,
+                const std::shared_ptr<const Chunk> &home,
+                int32_t chunkX,
+                int32_t chunkY)
+        : _map(map), _chunk(home), _chunkX(chunkX), _chunkY(chunkY)
+    {
+    }
+
+private:
+    const Chunk *Fetch(int32_t tileX, int32_t tileY)
+    {
+        const int32_t chunkX = tileX >> CHUNK_SHIFT;
+        const int32_t chunkY = tileY >> CHUNK_SHIFT;
+        if (chunkX != _chunkX || chunkY != _chunkY) {
+            _chunk = _map->Get(chunkX, chunkY);
+            _chunkX = chunkX;
+            _chunkY = chunkY;
+        }
+        return _chunk.get();
+    }
+
+    ChunkMap *_map;
+    std::shared_ptr<const Chunk> _chunk;
+    int32_t _chunkX;
+    int32_t _chunkY;
+};
+
+struct ChunkedFrame {
+    ChunkMap *map;
+    const std::shared_ptr<const Chunk> *home;
+    uint32_t playerX;
+    uint32_t playerY;
+    int16_t playerA;
+    uint8_t viewAngle;
+    const uint16_t *deltaAngle;
+};
+
+// CalculateDistance<Quarter> with 24.8 positions, 32-bit intercepts and the
+// chunk's occupancy in place of g_occupancy
+template <uint8_t Quarter>
+static inline void CalculateDistance(ChunkCursor *cursor,
+                                     uint32_t rayX,
+                                     uint32_t rayY,
+                                     uint8_t angle,
+                                     int32_t *deltaX,
+                                     int32_t *deltaY,
+                                     uint8_t *textureNo,
+                                     uint8_t *textureX,
+                                     uint8_t *material)
+{
+    constexpr int8_t tileStepX = Quarter < 2 ? 1 : -1;
+    constexpr int8_t tileStepY = Quarter == 0 || Quarter == 3 ? 1 : -1;
+
+    int32_t interceptX = rayX;
+    int32_t interceptY = rayY;
+
+    const uint8_t offsetX = rayX % 256;
+    const uint8_t offsetY = rayY % 256;
+
+    int32_t tileX = rayX >> 8;
+    int32_t tileY = rayY >> 8;
+    int32_t hitX;
+    int32_t hitY;
+
+    if (angle == 0) {
+        if constexpr (Quarter % 2 == 0) {
+            for (;;) {
+                const int32_t next = tileY + tileStepY;
+                const uint8_t cell = cursor->Occupancy(tileX, next);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileY = next;
+                    break;
+                }
+                tileY += BlockRun<tileStepY>(next, cell) * tileStepY;
+            }
+            hitX = interceptX;
+            hitY = (tileY << 8) + (Quarter == 2 ? 256 : 0);
+            *textureNo = 0;
+            *textureX = interceptX & 0xFF;
+        } else {
+            for (;;) {
+                const int32_t next = tileX + tileStepX;
+                const uint8_t cell = cursor->Occupancy(next, tileY);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileX = next;
+                    break;
+                }
+                tileX += BlockRun<tileStepX>(next, cell) * tileStepX;
+            }
+            hitX = (tileX << 8) + (Quarter == 3 ? 256 : 0);
+            hitY = interceptY;
+            *textureNo = 1;
+            *textureX = interceptY & 0xFF;
+        }
+        goto WallHit;
+    } else {
+        int32_t stepX;
+        int32_t stepY;
+
+        if constexpr (tileStepX == 1) {
+            interceptY += MulTan(offsetX, true, Quarter, angle, g_cotan);
+            interceptX -= 256;
+            stepX = AbsTan(Quarter, angle, g_tan);
+        } else {
+            interceptY -= MulTan(offsetX, false, Quarter, angle, g_cotan);
+            stepX = -AbsTan(Quarter, angle, g_tan);
+        }
+
+        if constexpr (tileStepY == 1) {
+            interceptX += MulTan(offsetY, true, Quarter, angle, g_tan);
+            interceptY -= 256;
+            stepY = AbsTan(Quarter, angle, g_cotan);
+        } else {
+            interceptX -= MulTan(offsetY, false, Quarter, angle, g_tan);
+            stepY = -AbsTan(Quarter, angle, g_cotan);
+        }
+
+        // blocks never straddle chunks, so a run stays in the cursor's chunk
+        const uint8_t index = Quarter & 1 ? INVERT(angle) : angle;
+        const uint64_t reciprocalX = g_tanReciprocal[index];
+        const uint64_t reciprocalY = g_cotanReciprocal[index];
+        const bool shallowX = std::abs(stepY) <= RUN_MAX_CROSS;
+        const bool shallowY = std::abs(stepX) <= RUN_MAX_CROSS;
+        for (;;) {
+            while (tileStepY == 1 ? interceptY >> 8 < tileY
+                                  : interceptY >> 8 >= tileY) {
+                const int32_t next = tileX + tileStepX;
+                const uint8_t cell = cursor->Occupancy(next, tileY);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileX = next;
+                    goto VerticalHit;
+                }
+                if (shallowX && cell) {
+                    const int32_t run = std::min(
+                        BlockRun<tileStepX>(next, cell),
+                        RowRun<tileStepY>(interceptY, tileY, reciprocalY));
+                    tileX += run * tileStepX;
+                    interceptY += run * stepY;
+                    continue;
+                }
+                tileX = next;
+                interceptY += stepY;
+            }
+            while (tileStepX == 1 ? interceptX >> 8 < tileX
+                                  : interceptX >> 8 >= tileX) {
+                const int32_t next = tileY + tileStepY;
+                const uint8_t cell = cursor->Occupancy(tileX, next);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileY = next;
+                    goto HorizontalHit;
+                }
+                if (shallowY && cell) {
+                    const int32_t run = std::min(
+                        BlockRun<tileStepY>(next, cell),
+                        RowRun<tileStepX>(interceptX, tileX, reciprocalX));
+                    tileY += run * tileStepY;
+                    interceptX += run * stepX;
+                    continue;
+                }
+                tileY = next;
+                interceptX += stepX;
+            }
+        }
+    }
+
+HorizontalHit:
+    hitX = interceptX + (tileStepX == 1 ? 256 : 0);
+    hitY = (tileY << 8) + (tileStepY == -1 ? 256 : 0);
+    *textureNo = 0;
+    *textureX = interceptX & 0xFF;
+    goto WallHit;
+
+VerticalHit:
+    hitX = (tileX << 8) + (tileStepX == -1 ? 256 : 0);
+    hitY = interceptY + (tileStepY == 1 ? 256 : 0);
+    *textureNo = 1;
+    *textureX = interceptY & 0xFF;
+
+WallHit:
+    *deltaX = hitX - static_cast<int32_t>(rayX);
+    *deltaY = hitY - static_cast<int32_t>(rayY);
+    *material = cursor->Material(tileX, tileY);
+}
+
+// MulS without the 16-bit result
+static inline int32_t MulS32(uint8_t v, int32_t f)
+{
+    const int32_t uf = (v * static_cast<int64_t>(std::abs(f))) >> 8;
+    return f < 0 ? ~uf : uf;
+}
+
+// ProjectDistance<ViewQuarter> with 32-bit deltas
+template <uint8_t ViewQuarter>
+static inline int32_t ProjectDistance(int16_t playerA,
+                                      uint8_t viewAngle,
+                                      int32_t deltaX,
+                                      int32_t deltaY)
+{
+    int32_t distance = 0;
+    if (playerA == 0) {
+        distance += deltaY;
+    } else if (playerA == 512) {
+        distance -= deltaY;
+    } else if constexpr (ViewQuarter == 0) {
+        distance += MulS32(g_cos[viewAngle], deltaY);
+    } else if constexpr (ViewQuarter == 1) {
+        distance -= MulS32(g_cos[INVERT(viewAngle)], deltaY);
+    } else if constexpr (ViewQuarter == 2) {
+        distance -= MulS32(g_cos[viewAngle], deltaY);
+    } else {
+        distance += MulS32(g_cos[INVERT(viewAngle)], deltaY);
+    }
+
+    if (playerA == 256) {
+        distance += deltaX;
+    } else if (playerA == 768) {
+        distance -= deltaX;
+    } else if constexpr (ViewQuarter == 0) {
+        distance += MulS32(g_sin[viewAngle], deltaX);
+    } else if constexpr (ViewQuarter == 1) {
+        distance += MulS32(g_sin[INVERT(viewAngle)], deltaX);
+    } else if constexpr (ViewQuarter == 2) {
+        distance -= MulS32(g_sin[viewAngle], deltaX);
+    } else {
+        distance -= MulS32(g_sin[INVERT(viewAngle)], deltaX);
+    }
+    return distance;
+}
+
+static inline uint16_t RayAngle(const ChunkedFrame &f, uint16_t screenX)
+{
+    return NeutralizeAngle(
+        static_cast<uint16_t>(f.playerA + f.deltaAngle[screenX]));
+}
+
+template <uint8_t Quarter, uint8_t ViewQuarter>
+static inline RayCaster::TraceResult TraceRay(const ChunkedFrame &f,
+                                              ChunkCursor *cursor,
+                                              uint16_t rayAngle)
+{
+    RayCaster::TraceResult res;
+    int32_t deltaX;
+    int32_t deltaY;
+    CalculateDistance<Quarter>(cursor, f.playerX, f.playerY, rayAngle % 256,
+                               &deltaX, &deltaY, &res.textureNo,
+                               &res.textureX, &res.material);
+
+    const int32_t distance =
+        ProjectDistance<ViewQuarter>(f.playerA, f.viewAngle, deltaX, deltaY);
+    res.distance = std::min(std::max(distance, 0), 0xFFFF);
+    if (distance >= MIN_DIST) {
+        res.textureY = 0;
+        LookupHeight(std::min((distance - MIN_DIST) >> 2, 0xFFFF),
+                     &res.screenY, &res.textureStep);
+    } else {
+        const int32_t d = std::max(distance, 0);
+        res.screenY = SCREEN_HEIGHT >> 1;
+        res.textureY = g_overflowOffset[d];
+        res.textureStep = g_overflowStep[d];
+    }
+    return res;
+}
+
+template <uint8_t ViewQuarter>
+static inline RayCaster::TraceResult TraceRay(const ChunkedFrame &f,
+                                              ChunkCursor *cursor,
+                                              uint16_t screenX)
+{
+    const uint16_t rayAngle = RayAngle(f, screenX);
+    switch (rayAngle >> 8) {
+    case 0:
+        return TraceRay<0, ViewQuarter>(f, cursor, rayAngle);
+    case 1:
+        return TraceRay<1, ViewQuarter>(f, cursor, rayAngle);
+    case 2:
+        return TraceRay<2, ViewQuarter>(f, cursor, rayAngle);
+    default:
+        return TraceRay<3, ViewQuarter>(f, cursor, rayAngle);
+    }
+}
+
+template <uint8_t Quarter, uint8_t ViewQuarter>
+static uint16_t TraceRun(const ChunkedFrame &f,
+                         ChunkCursor *cursor,
+                         uint16_t x,
+                         uint16_t end,
+                         RayCaster::TraceBatch *out)
+{
+    for (; x < end; x++) {
+        const uint16_t rayAngle = RayAngle(f, x);
+        if (rayAngle >> 8 != Quarter) {
+            break;
+        }
+        const auto res = TraceRay<Quarter, ViewQuarter>(f, cursor, rayAngle);
+        out->screenY[x] = res.screenY;
+        out->textureNo[x] = res.textureNo;
+        out->textureX[x] = res.textureX;
+        out->textureY[x] = res.textureY;
+        out->textureStep[x] = res.textureStep;
+        out->material[x] = res.material;
+        out->distance[x] = res.distance;
+    }
+    return x;
+}
+
+// one cursor for the whole span, neighbouring rays mostly see the same chunks
+template <uint8_t ViewQuarter>
+static void TraceSpan(const ChunkedFrame &f,
+                      uint16_t first,
+                      uint16_t count,
+                      RayCaster::TraceBatch *out)
+{
+    ChunkCursor cursor(f.map, *f.home, f.playerX >> (8 + CHUNK_SHIFT),
+                       f.playerY >> (8 + CHUNK_SHIFT));
+    const uint16_t end = first + count;
+    uint16_t x = first;
+    while (x < end) {
+        switch (RayAngle(f, x) >> 8) {
+        case 0:
+            x = TraceRun<0, ViewQuarter>(f, &cursor, x, end, out);
+            break;
+        case 1:
+            x = TraceRun<1, ViewQuarter>(f, &cursor, x, end, out);
+            break;
+        case 2:
+            x = TraceRun<2, ViewQuarter>(f, &cursor, x, end, out);
+            break;
+        default:
+            x = TraceRun<3, ViewQuarter>(f, &cursor, x, end, out);
+            break;
+        }
+    }
+}
+
+RayCasterChunked::TraceResult RayCasterChunked::Trace(uint16_t screenX)
+{
+    const ChunkedFrame f = {_map,      &_home,     _playerX,   _playerY,
+                            _playerA, _viewAngle, _deltaAngle};
+    ChunkCursor cursor(_map, _home, _playerX >> (8 + CHUNK_SHIFT),
+                       _playerY >> (8 + CHUNK_SHIFT));
+    switch (_viewQuarter) {
+    case 0:
+        return TraceRay<0>(f, &cursor, screenX);
+    case 1:
+        return TraceRay<1>(f, &cursor, screenX);
+    case 2:
+        return TraceRay<2>(f, &cursor, screenX);
+    default:
+        return TraceRay<3>(f, &cursor, screenX);
+    }
+}
+
+void RayCasterChunked::TraceColumns(uint16_t first,
+                                    uint16_t count,
+                                    TraceBatch *out) const
+{
+    const ChunkedFrame f = {_map,      &_home,     _playerX,   _playerY,
+                            _playerA, _viewAngle, _deltaAngle};
+    switch (_viewQuarter) {
+    case 0:
+        TraceSpan<0>(f, first, count, out);
+        break;
+    case 1:
+        TraceSpan<1>(f, first, count, out);
+        break;
+    case 2:
+        TraceSpan<2>(f, first, count, out);
+        break;
+    default:
+        TraceSpan<3>(f, first, count, out);
+        break;
+    }
+}
+
+void RayCasterChunked::SetColumns(uint16_t columns)
+{
+    if (columns == _columns) {
+        return;
+    }
+    _columns = columns;
+    ColumnAngles(columns, _deltaAngle);
+}
+
+// ChunkMap is safe to share, the clone keeps its own home chunk
+std::unique_ptr<RayCaster> RayCasterChunked::Clone() const
+{
+    std::unique_ptr<RayCasterChunked> clone(new RayCasterChunked(_map));
+    clone->SetColumns(_columns);
+    return clone;
+}
+
+void RayCasterChunked::Start(uint32_t playerX,
+                             uint32_t playerY,
+                             int16_t playerA)
+{
+    playerA &= 1023;
+    _viewQuarter = playerA >> 8;
+    _viewAngle = playerA % 256;
+    _playerX = playerX;
+    _playerY = playerY;
+    _playerA = playerA;
+    _home =
+        _map->Get(playerX >> (8 + CHUNK_SHIFT), playerY >> (8 + CHUNK_SHIFT));
+}
+
+RayCasterChunked::RayCasterChunked(ChunkMap *map) : RayCaster(), _map(map)
+{
+    _playerX = 0;
+    _playerY = 0;
+    _playerA = 0;
+    _viewQuarter = 0;
+    _viewAngle = 0;
+    _columns = SCREEN_WIDTH;
+    ColumnAngles(SCREEN_WIDTH, _deltaAngle);
+    _home = _map->Get(0, 0);
+}
+
+RayCasterChunked::~RayCasterChunked() {}
@@ -0,0 +1,33 @@
+#pragma once
+#include <memory>
+#include "chunk_map.h"
+#include "raycaster.h"
+
+// fixed-point caster over a ChunkMap: positions are 24.8, so worlds can be
+// far larger than the 256 tiles RayCasterFixed addresses
+class RayCasterChunked : public RayCaster
+{
+public:
+    void Start(uint32_t playerX, uint32_t playerY, int16_t playerA) override;
+    TraceResult Trace(uint16_t screenX) override;
+    void TraceColumns(uint16_t first,
+                      uint16_t count,
+                      TraceBatch *out) const override;
+    void SetColumns(uint16_t columns) override;
+    std::unique_ptr<RayCaster> Clone() const override;
+
+    RayCasterChunked(ChunkMap *map);
+    ~RayCasterChunked();
+
+private:
+    ChunkMap *_map;
+    // the chunk under the player, most rays start and end in it
+    std::shared_ptr<const Chunk> _home;
+    uint32_t _playerX;
+    uint32_t _playerY;
+    int16_t _playerA;
+    uint8_t _viewQuarter;
+    uint8_t _viewAngle;
+    uint16_t _columns;
+    uint16_t _deltaAngle[SCREEN_WIDTH];
+};
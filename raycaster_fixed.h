@@ -1,19 +1,50 @@
 #pragma once
+#include <atomic>
 #include "raycaster.h"
 
+// one entry per absolute ray angle
+#define HIT_CACHE_SIZE 1024
+
 class RayCasterFixed : public RayCaster
 {
 public:
-    void Start(uint16_t playerX, uint16_t playerY, int16_t playerA) override;
+    void Start(uint32_t playerX, uint32_t playerY, int16_t playerA) override;
     TraceResult Trace(uint16_t screenX) override;
+    void TraceColumns(uint16_t first,
+                      uint16_t count,
+                      TraceBatch *out) const override;
+    void SetColumns(uint16_t columns) override;
+    void SetDoors(const DoorMap *doors) override { _doors = doors; }
+    std::unique_ptr<RayCaster> Clone() const override;
+
+    // rays answered from the hit cache, and traced into it
+    uint64_t CacheHits() const { return _cacheHits.load(); }
+    uint64_t CacheMisses() const { return _cacheMisses.load(); }
 
     RayCasterFixed();
     ~RayCasterFixed();
 
 private:
+    const uint16_t *Doors() const;
+
     uint16_t _playerX;
     uint16_t _playerY;
     int16_t _playerA;
     uint8_t _viewQuarter;
     uint8_t _viewAngle;
+    uint16_t _columns;
+    uint16_t _deltaAngle[SCREEN_WIDTH];
+    const DoorMap *_doors = nullptr;
+
+    // CalculateDistance results for the position and doors of the last
+    // Start, filled lazily by angle; entries of older positions carry an
+    // older generation
+    mutable std::atomic<uint64_t> _cache[HIT_CACHE_SIZE];
+    uint16_t _generation = 0;
+    uint16_t _cachedX;
+    uint16_t _cachedY;
+    const DoorMap *_cachedDoors = nullptr;
+    uint32_t _cachedDoorVersion = 0;
+    mutable std::atomic<uint64_t> _cacheHits{0};
+    mutable std::atomic<uint64_t> _cacheMisses{0};
 };
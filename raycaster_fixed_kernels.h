@@ -0,0 +1,872 @@
+#pragma once
+// fixed-point lookup tables and the per-ray kernels of RayCasterFixed, shared
+// with the tools and benchmarks
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include "gcem.hpp"
+#include "profiler.h"
+#include "raycaster.h"
+#include "raycaster_data.h"
+#include "raycaster_map.h"
+
+template <typename T, typename V>
+constexpr T clamp_cast(V v)
+{
+    return static_cast<T>(std::clamp<V>(v, std::numeric_limits<T>::min(),
+                                        std::numeric_limits<T>::max()));
+}
+
+inline constexpr auto g_tan = []() constexpr
+{
+    std::array<uint16_t, 256> g_tan{};
+    for (int i = 0; i < 256; i++)
+        g_tan[i] =
+            static_cast<uint16_t>((256.0f * gcem::tan(i * M_PI_2 / 256.0f)));
+    g_tan[128] = 255;  // fixme
+    return g_tan;
+}
+();
+
+inline constexpr auto g_cotan = []() constexpr
+{
+    std::array<uint16_t, 256> g_cotan{};
+    for (int i = 0; i < 256; i++) {
+        auto t = gcem::tan(i * M_PI_2 / 256.0f);
+        g_cotan[i] =
+            t != 0
+                ? static_cast<uint16_t>(256.0f / t)
+                : static_cast<uint16_t>(std::numeric_limits<uint16_t>::max());
+    }
+    g_cotan[0] = 0;
+    return g_cotan;
+}
+();
+
+inline constexpr auto g_sin = []() constexpr
+{
+    std::array<uint8_t, 256> g_sin{};
+    for (int i = 0; i < 256; i++) {
+        g_sin[i] =
+            static_cast<uint8_t>(256.0f * gcem::sin(i / 1024.0f * 2 * M_PI));
+    }
+    return g_sin;
+}
+();
+
+inline constexpr auto g_cos = []() constexpr
+{
+    std::array<uint8_t, 256> g_cos{};
+    for (int i = 0; i < 256; i++) {
+        g_cos[i] =
+            clamp_cast<uint8_t>(256.0f * gcem::cos(i / 1024.0f * 2 * M_PI));
+    }
+    g_cos[0] = 0;
+    return g_cos;
+}
+();
+
+inline constexpr auto g_deltaAngle = []() constexpr
+{
+    std::array<uint16_t, SCREEN_WIDTH> g_deltaAngle{};
+    for (int i = 0; i < SCREEN_WIDTH; i++) {
+        float deltaAngle = gcem::atan(((int16_t) i - SCREEN_WIDTH / 2.0f) /
+                                      (SCREEN_WIDTH / 2.0f) * M_PI / 4);
+        int16_t da = static_cast<int16_t>(deltaAngle / M_PI_2 * 256.0f);
+        if (da < 0) {
+            da += 1024;
+        }
+        g_deltaAngle[i] = static_cast<uint16_t>(da);
+    }
+    return g_deltaAngle;
+}
+();
+
+inline constexpr auto g_nearHeight = []() constexpr
+{
+    std::array<uint8_t, 256> g_nearHeight{};
+    for (int i = 0; i < 256; i++) {
+        g_nearHeight[i] = static_cast<uint8_t>(
+            (INV_FACTOR_INT / (((i << 2) + MIN_DIST) >> 2)) >> 2);
+    }
+    return g_nearHeight;
+}
+();
+
+inline constexpr auto g_farHeight = []() constexpr
+{
+    std::array<uint8_t, 256> g_farHeight{};
+    for (int i = 0; i < 256; i++) {
+        g_farHeight[i] = static_cast<uint8_t>(
+            (INV_FACTOR_INT / (((i << 5) + MIN_DIST) >> 5)) >> 5);
+    }
+    return g_farHeight;
+}
+();
+
+inline constexpr auto g_nearStep = []() constexpr
+{
+    std::array<uint16_t, 256> g_nearStep{};
+    for (int i = 0; i < 256; i++) {
+        auto txn =
+            ((INV_FACTOR_INT / (((i * 4.0f) + MIN_DIST) / 4.0f)) / 4.0f) * 2.0f;
+        if (txn != 0) {
+            g_nearStep[i] = (256 / txn) * 256;
+        }
+    }
+    return g_nearStep;
+}
+();
+
+inline constexpr auto g_farStep = []() constexpr
+{
+    std::array<uint16_t, 256> g_farStep{};
+    for (int i = 0; i < 256; i++) {
+        auto txf =
+            ((INV_FACTOR_INT / (((i * 32.0f) + MIN_DIST) / 32.0f)) / 32.0f) *
+            2.0f;
+        if (txf != 0) {
+            g_farStep[i] = (256 / txf) * 256;
+        }
+    }
+    return g_farStep;
+}
+();
+
+inline constexpr auto g_overflowStep = []() constexpr
+{
+    std::array<uint16_t, 256> g_overflowStep{};
+    for (int i = 1; i < 256; i++) {
+        auto txs = ((INV_FACTOR_INT / (float) (i / 2.0f)));
+        g_overflowStep[i] = (256 / txs) * 256;
+    }
+    return g_overflowStep;
+}
+();
+
+inline constexpr auto g_overflowOffset = []() constexpr
+{
+    std::array<uint16_t, 256> g_overflowOffset{};
+    for (int i = 1; i < 256; i++) {
+        auto txs = ((INV_FACTOR_INT / (float) (i / 2.0f)));
+        auto ino = (txs - SCREEN_HEIGHT) / 2;
+        g_overflowOffset[i] = static_cast<uint16_t>(
+            static_cast<int>(ino * (256 / txs) * 256) & 0xFFFFFFFF);
+    }
+    return g_overflowOffset;
+}
+();
+
+// (v * f) >> 8
+inline uint16_t MulU(uint8_t v, uint16_t f)
+{
+    const uint8_t f_h = f >> 8;
+    const uint8_t f_l = f % 256;
+    const uint16_t hm = v * f_h;
+    const uint16_t lm = v * f_l;
+    return hm + (lm >> 8);
+}
+
+inline int16_t MulS(uint8_t v, int16_t f)
+{
+    const uint16_t uf = MulU(v, static_cast<uint16_t>(std::abs(f)));
+    return f < 0 ? ~uf : uf;
+}
+
+template <typename Table>
+inline int16_t AbsTan(uint8_t quarter, uint8_t angle, const Table &lookupTable)
+{
+    return lookupTable[quarter & 1 ? INVERT(angle) : angle];
+}
+
+template <typename Table>
+inline int16_t MulTan(uint8_t value,
+               bool inverse,
+               uint8_t quarter,
+               uint8_t angle,
+               const Table &lookupTable)
+{
+    uint8_t signedValue = value;
+    if (inverse) {
+        if (value == 0) {
+            if (quarter % 2 == 1) {
+                return -AbsTan(quarter, angle, lookupTable);
+            }
+            return AbsTan(quarter, angle, lookupTable);
+        }
+        signedValue = INVERT(value);
+    }
+    if (signedValue == 0) {
+        return 0;
+    }
+    if (quarter % 2 == 1) {
+        return -MulU(signedValue, lookupTable[INVERT(angle)]);
+    }
+    return MulU(signedValue, lookupTable[angle]);
+}
+
+inline bool IsWall(uint8_t tileX, uint8_t tileY)
+{
+    return g_tiles[TileIndex(tileX, tileY)] != 0;
+}
+
+static_assert(MAP_X == 32 && MAP_Y == 32, "occupancy masks assume 32x32");
+
+// occupancy summaries of g_map for skipping open space: a bit per 4x4 block
+// (8x8 blocks) and per 16x16 block (2x2 blocks), set when IsWall is false
+// on every tile of the block
+inline constexpr uint64_t g_empty4 = []() constexpr
+{
+    uint64_t empty = 0;
+    for (int i = 0; i < 64; i++) {
+        bool wall = false;
+        for (int y = (i >> 3) * 4; y < (i >> 3) * 4 + 4; y++) {
+            for (int x = (i & 7) * 4; x < (i & 7) * 4 + 4; x++) {
+                wall |= g_tiles[TileIndex(x, y)] != 0;
+            }
+        }
+        if (!wall) {
+            empty |= uint64_t(1) << i;
+        }
+    }
+    return empty;
+}
+();
+
+inline constexpr uint8_t g_empty16 = []() constexpr
+{
+    uint8_t empty = 0;
+    for (int i = 0; i < 4; i++) {
+        // the 4x4 blocks of 16x16 block i
+        const uint64_t rows = uint64_t(0x0F0F0F0F)
+                              << ((i >> 1) * 32 + (i & 1) * 4);
+        if ((g_empty4 & rows) == rows) {
+            empty |= 1 << i;
+        }
+    }
+    return empty;
+}
+();
+
+#define OCC_WALL 0xFF
+// steepest ray slope, in 1/256 tiles per tile, that skips blocks
+#define RUN_MAX_CROSS 128
+
+// g_empty4/g_empty16 spread over g_tiles, so one load per step answers
+// both whether the tile is a wall and how large an empty block it is in:
+// OCC_WALL, or log2 of the block size (0 for a lone open tile)
+inline constexpr auto g_occupancy = []() constexpr
+{
+    std::array<uint8_t, TILES_STRIDE * (MAP_Y + 2)> occupancy{};
+    for (int y = -1; y <= MAP_Y; y++) {
+        for (int x = -1; x <= MAP_X; x++) {
+            uint8_t cell = 0;
+            if (g_tiles[TileIndex(x, y)]) {
+                cell = OCC_WALL;
+            } else if (g_empty16 >> ((y >> 4) * 2 + (x >> 4)) & 1) {
+                cell = 4;
+            } else if (g_empty4 >> ((y >> 2) * 8 + (x >> 2)) & 1) {
+                cell = 2;
+            }
+            occupancy[TileIndex(x, y)] = cell;
+        }
+    }
+    return occupancy;
+}
+();
+
+inline uint8_t Occupancy(uint8_t tileX, uint8_t tileY)
+{
+    return g_occupancy[TileIndex(tileX, tileY)];
+}
+
+// tiles from tile to the edge of its block of 1 << sizeShift tiles, walking
+// in Step
+template <int8_t Step>
+inline int32_t BlockRun(int32_t tile, uint8_t sizeShift)
+{
+    const int32_t inside = tile & ((1 << sizeShift) - 1);
+    return Step == 1 ? (1 << sizeShift) - inside : inside + 1;
+}
+
+// ceil(2^32 / v) of the step tables, so shallow rays can count the steps
+// left in a row without a division; exact for counts below 2^10
+template <typename Table>
+constexpr std::array<uint64_t, 256> Reciprocals(const Table &table)
+{
+    std::array<uint64_t, 256> reciprocals{};
+    for (int i = 0; i < 256; i++) {
+        if (table[i] != 0) {
+            reciprocals[i] = ((uint64_t(1) << 32) + table[i] - 1) / table[i];
+        }
+    }
+    return reciprocals;
+}
+
+inline constexpr auto g_tanReciprocal = Reciprocals(g_tan);
+inline constexpr auto g_cotanReciprocal = Reciprocals(g_cotan);
+
+// steps along one axis before the ray crosses into the next row (or column),
+// for a step of at most RUN_MAX_CROSS whose reciprocal is given
+template <int8_t CrossStep>
+inline int32_t RowRun(int32_t intercept, int32_t tile, uint64_t reciprocal)
+{
+    const uint32_t distance = CrossStep == 1 ? (tile << 8) - 1 - intercept
+                                             : intercept - (tile << 8);
+    return static_cast<int32_t>((distance * reciprocal) >> 32) + 1;
+}
+
+inline void LookupHeight(uint16_t distance, uint8_t *height, uint16_t *step)
+{
+    if (distance >= 256) {
+        const uint16_t ds = distance >> 3;
+        if (ds >= 256) {
+            *height = g_farHeight[255] - 1;
+            *step = g_farStep[255];
+        } else {
+            *height = g_farHeight[ds];
+            *step = g_farStep[ds];
+        }
+    } else {
+        *height = g_nearHeight[distance];
+        *step = g_nearStep[distance];
+    }
+}
+
+inline void CalculateDistance(uint16_t rayX,
+                       uint16_t rayY,
+                       uint16_t rayA,
+                       int16_t *deltaX,
+                       int16_t *deltaY,
+                       uint8_t *textureNo,
+                       uint8_t *textureX)
+{
+    int8_t tileStepX = 0;
+    int8_t tileStepY = 0;
+    int16_t interceptX = rayX;
+    int16_t interceptY = rayY;
+
+    const uint8_t quarter = rayA >> 8;
+    const uint8_t angle = rayA % 256;
+    const uint8_t offsetX = rayX % 256;
+    const uint8_t offsetY = rayY % 256;
+
+    uint8_t tileX = rayX >> 8;
+    uint8_t tileY = rayY >> 8;
+    int16_t hitX;
+    int16_t hitY;
+
+    if (angle == 0) {
+        switch (quarter % 2) {
+        case 0:
+            tileStepX = 0;
+            tileStepY = quarter == 0 ? 1 : -1;
+            if (tileStepY == 1) {
+                interceptY -= 256;
+            }
+            for (;;) {
+                tileY += tileStepY;
+                if (IsWall(tileX, tileY)) {
+                    goto HorizontalHit;
+                }
+            }
+            break;
+        case 1:
+            tileStepY = 0;
+            tileStepX = quarter == 1 ? 1 : -1;
+            if (tileStepX == 1) {
+                interceptX -= 256;
+            }
+            for (;;) {
+                tileX += tileStepX;
+                if (IsWall(tileX, tileY)) {
+                    goto VerticalHit;
+                }
+            }
+            break;
+        }
+    } else {
+        int16_t stepX = 0;
+        int16_t stepY = 0;
+
+        switch (quarter) {
+        case 0:
+        case 1:
+            tileStepX = 1;
+            interceptY += MulTan(offsetX, true, quarter, angle, g_cotan);
+            interceptX -= 256;
+            stepX = AbsTan(quarter, angle, g_tan);
+            break;
+        case 2:
+        case 3:
+            tileStepX = -1;
+            interceptY -= MulTan(offsetX, false, quarter, angle, g_cotan);
+            stepX = -AbsTan(quarter, angle, g_tan);
+            break;
+        }
+
+        switch (quarter) {
+        case 0:
+        case 3:
+            tileStepY = 1;
+            interceptX += MulTan(offsetY, true, quarter, angle, g_tan);
+            interceptY -= 256;
+            stepY = AbsTan(quarter, angle, g_cotan);
+            break;
+        case 1:
+        case 2:
+            tileStepY = -1;
+            interceptX -= MulTan(offsetY, false, quarter, angle, g_tan);
+            stepY = -AbsTan(quarter, angle, g_cotan);
+            break;
+        }
+
+        for (;;) {
+            while ((tileStepY == 1 && (interceptY >> 8 < tileY)) ||
+                   (tileStepY == -1 && (interceptY >> 8 >= tileY))) {
+                tileX += tileStepX;
+                if (IsWall(tileX, tileY)) {
+                    goto VerticalHit;
+                }
+                interceptY += stepY;
+            }
+            while ((tileStepX == 1 && (interceptX >> 8 < tileX)) ||
+                   (tileStepX == -1 && (interceptX >> 8 >= tileX))) {
+                tileY += tileStepY;
+                if (IsWall(tileX, tileY)) {
+                    goto HorizontalHit;
+                }
+                interceptX += stepX;
+            }
+        }
+    }
+
+HorizontalHit:
+    hitX = interceptX + (tileStepX == 1 ? 256 : 0);
+    hitY = (tileY << 8) + (tileStepY == -1 ? 256 : 0);
+    *textureNo = 0;
+    *textureX = interceptX & 0xFF;
+    goto WallHit;
+
+VerticalHit:
+    hitX = (tileX << 8) + (tileStepX == -1 ? 256 : 0);
+    hitY = interceptY + (tileStepY == 1 ? 256 : 0);
+    *textureNo = 1;
+    *textureX = interceptY & 0xFF;
+    goto WallHit;
+
+WallHit:
+    *deltaX = hitX - rayX;
+    *deltaY = hitY - rayY;
+}
+
+// whether a ray entering door tile (tileX, tileY) at (enterX, enterY) stops
+// on the door; if so (hitX, hitY) is where. stepX is the ray's x change per
+// tile of y, stepY its y change per tile of x, 0 for rays along the other
+// axis. doors holds the open amounts, null for all closed
+inline bool DoorHit(const uint16_t *doors,
+                    uint8_t tileX,
+                    uint8_t tileY,
+                    int16_t enterX,
+                    int16_t enterY,
+                    int16_t stepX,
+                    int16_t stepY,
+                    int16_t *hitX,
+                    int16_t *hitY,
+                    uint8_t *textureNo,
+                    uint8_t *textureX)
+{
+    const uint8_t door = g_doorIndex[TileIndex(tileX, tileY)];
+    const uint16_t open = doors != nullptr ? doors[door] : 0;
+    int32_t along;
+    if (g_doorTiles[door].vertical) {
+        const int32_t toPlane = (tileX << 8) + 128 - enterX;
+        // parallel to the plane, or past it
+        if (stepX == 0 || (toPlane ^ stepX) < 0) {
+            return false;
+        }
+        *hitX = (tileX << 8) + 128;
+        *hitY = enterY + ((std::abs(toPlane) * stepY) >> 8);
+        along = *hitY - (tileY << 8);
+        *textureNo = 1;
+    } else {
+        const int32_t toPlane = (tileY << 8) + 128 - enterY;
+        if (stepY == 0 || (toPlane ^ stepY) < 0) {
+            return false;
+        }
+        *hitX = enterX + ((std::abs(toPlane) * stepX) >> 8);
+        *hitY = (tileY << 8) + 128;
+        along = *hitX - (tileX << 8);
+        *textureNo = 0;
+    }
+    // leaves the tile before the plane, or crosses the open part
+    if (along < open || along >= 256) {
+        return false;
+    }
+    *textureX = along - open;
+    return true;
+}
+
+// CalculateDistance for rays in one quarter: the tile steps and the MulTan
+// signs are constants, so the traversal loops carry no direction tests, and
+// empty blocks of g_occupancy are crossed in one step where possible.
+// angle is rayA % 256; results match CalculateDistance bit for bit, and
+// material is the hit tile's. Door tiles are walls in g_occupancy, so only
+// rays that stop at one pay for DoorHit, and go on if they pass the door
+template <uint8_t Quarter>
+inline void CalculateDistance(uint16_t rayX,
+                              uint16_t rayY,
+                              uint8_t angle,
+                              int16_t *deltaX,
+                              int16_t *deltaY,
+                              uint8_t *textureNo,
+                              uint8_t *textureX,
+                              uint8_t *material,
+                              const uint16_t *doors = nullptr)
+{
+    constexpr int8_t tileStepX = Quarter < 2 ? 1 : -1;
+    constexpr int8_t tileStepY = Quarter == 0 || Quarter == 3 ? 1 : -1;
+
+    int16_t interceptX = rayX;
+    int16_t interceptY = rayY;
+
+    const uint8_t offsetX = rayX % 256;
+    const uint8_t offsetY = rayY % 256;
+
+    uint8_t tileX = rayX >> 8;
+    uint8_t tileY = rayY >> 8;
+    int16_t hitX;
+    int16_t hitY;
+
+    if (angle == 0) {
+        // straight along +y, +x, -y, -x for quarters 0, 1, 2, 3
+        if constexpr (Quarter % 2 == 0) {
+            for (;;) {
+                const uint8_t next = tileY + tileStepY;
+                const uint8_t cell = Occupancy(tileX, next);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileY = next;
+                    if (g_tiles[TileIndex(tileX, tileY)] != MATERIAL_DOOR) {
+                        break;
+                    }
+                    PROFILE_COUNT(PROFILE_DOOR_TESTS, 1);
+                    if (DoorHit(doors, tileX, tileY, interceptX,
+                                (tileY << 8) + (Quarter == 2 ? 256 : 0), 0,
+                                tileStepY, &hitX, &hitY, textureNo,
+                                textureX)) {
+                        goto WallHit;
+                    }
+                    continue;
+                }
+                tileY += BlockRun<tileStepY>(next, cell) * tileStepY;
+            }
+            hitX = interceptX;
+            hitY = (tileY << 8) + (Quarter == 2 ? 256 : 0);
+            *textureNo = 0;
+            *textureX = interceptX & 0xFF;
+        } else {
+            for (;;) {
+                const uint8_t next = tileX + tileStepX;
+                const uint8_t cell = Occupancy(next, tileY);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileX = next;
+                    if (g_tiles[TileIndex(tileX, tileY)] != MATERIAL_DOOR) {
+                        break;
+                    }
+                    PROFILE_COUNT(PROFILE_DOOR_TESTS, 1);
+                    if (DoorHit(doors, tileX, tileY,
+                                (tileX << 8) + (Quarter == 3 ? 256 : 0),
+                                interceptY, tileStepX, 0, &hitX, &hitY,
+                                textureNo, textureX)) {
+                        goto WallHit;
+                    }
+                    continue;
+                }
+                tileX += BlockRun<tileStepX>(next, cell) * tileStepX;
+            }
+            hitX = (tileX << 8) + (Quarter == 3 ? 256 : 0);
+            hitY = interceptY;
+            *textureNo = 1;
+            *textureX = interceptY & 0xFF;
+        }
+        goto WallHit;
+    } else {
+        int16_t stepX;
+        int16_t stepY;
+
+        if constexpr (tileStepX == 1) {
+            interceptY += MulTan(offsetX, true, Quarter, angle, g_cotan);
+            interceptX -= 256;
+            stepX = AbsTan(Quarter, angle, g_tan);
+        } else {
+            interceptY -= MulTan(offsetX, false, Quarter, angle, g_cotan);
+            stepX = -AbsTan(Quarter, angle, g_tan);
+        }
+
+        if constexpr (tileStepY == 1) {
+            interceptX += MulTan(offsetY, true, Quarter, angle, g_tan);
+            interceptY -= 256;
+            stepY = AbsTan(Quarter, angle, g_cotan);
+        } else {
+            interceptX -= MulTan(offsetY, false, Quarter, angle, g_tan);
+            stepY = -AbsTan(Quarter, angle, g_cotan);
+        }
+
+        // in an empty block, shallow rays take all the steps up to the block
+        // edge or the next row (column) at once; steep ones cross a row every
+        // step or two anyway and go tile by tile
+        const uint8_t index = Quarter & 1 ? INVERT(angle) : angle;
+        const uint64_t reciprocalX = g_tanReciprocal[index];
+        const uint64_t reciprocalY = g_cotanReciprocal[index];
+        const bool shallowX = std::abs(stepY) <= RUN_MAX_CROSS;
+        const bool shallowY = std::abs(stepX) <= RUN_MAX_CROSS;
+        for (;;) {
+            while (tileStepY == 1 ? interceptY >> 8 < tileY
+                                  : interceptY >> 8 >= tileY) {
+                const uint8_t next = tileX + tileStepX;
+                const uint8_t cell = Occupancy(next, tileY);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileX = next;
+                    if (g_tiles[TileIndex(tileX, tileY)] != MATERIAL_DOOR) {
+                        goto VerticalHit;
+                    }
+                    PROFILE_COUNT(PROFILE_DOOR_TESTS, 1);
+                    if (DoorHit(doors, tileX, tileY,
+                                (tileX << 8) + (tileStepX == -1 ? 256 : 0),
+                                interceptY + (tileStepY == 1 ? 256 : 0),
+                                stepX, stepY, &hitX, &hitY, textureNo,
+                                textureX)) {
+                        goto WallHit;
+                    }
+                    interceptY += stepY;
+                    continue;
+                }
+                if (shallowX && cell) {
+                    const int32_t run = std::min(
+                        BlockRun<tileStepX>(next, cell),
+                        RowRun<tileStepY>(interceptY, tileY, reciprocalY));
+                    tileX += run * tileStepX;
+                    interceptY += run * stepY;
+                    continue;
+                }
+                tileX = next;
+                interceptY += stepY;
+            }
+            while (tileStepX == 1 ? interceptX >> 8 < tileX
+                                  : interceptX >> 8 >= tileX) {
+                const uint8_t next = tileY + tileStepY;
+                const uint8_t cell = Occupancy(tileX, next);
+                PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+                if (cell == OCC_WALL) {
+                    tileY = next;
+                    if (g_tiles[TileIndex(tileX, tileY)] != MATERIAL_DOOR) {
+                        goto HorizontalHit;
+                    }
+                    PROFILE_COUNT(PROFILE_DOOR_TESTS, 1);
+                    if (DoorHit(doors, tileX, tileY,
+                                interceptX + (tileStepX == 1 ? 256 : 0),
+                                (tileY << 8) + (tileStepY == -1 ? 256 : 0),
+                                stepX, stepY, &hitX, &hitY, textureNo,
+                                textureX)) {
+                        goto WallHit;
+                    }
+                    interceptX += stepX;
+                    continue;
+                }
+                if (shallowY && cell) {
+                    const int32_t run = std::min(
+                        BlockRun<tileStepY>(next, cell),
+                        RowRun<tileStepX>(interceptX, tileX, reciprocalX));
+                    tileY += run * tileStepY;
+                    interceptX += run * stepX;
+                    continue;
+                }
+                tileY = next;
+                interceptX += stepX;
+            }
+        }
+    }
+
+HorizontalHit:
+    hitX = interceptX + (tileStepX == 1 ? 256 : 0);
+    hitY = (tileY << 8) + (tileStepY == -1 ? 256 : 0);
+    *textureNo = 0;
+    *textureX = interceptX & 0xFF;
+    goto WallHit;
+
+VerticalHit:
+    hitX = (tileX << 8) + (tileStepX == -1 ? 256 : 0);
+    hitY = interceptY + (tileStepY == 1 ? 256 : 0);
+    *textureNo = 1;
+    *textureX = interceptY & 0xFF;
+
+WallHit:
+    *deltaX = hitX - rayX;
+    *deltaY = hitY - rayY;
+    *material = g_tiles[TileIndex(tileX, tileY)];
+}
+
+// the tile of a CalculateDistance<Quarter> hit along the axis it was found
+// on: its column for vertical hits (textureNo 1), its row otherwise
+template <uint8_t Quarter>
+inline uint8_t HitTile(uint16_t rayX,
+                       uint16_t rayY,
+                       int16_t deltaX,
+                       int16_t deltaY,
+                       uint8_t textureNo)
+{
+    constexpr int8_t tileStepX = Quarter < 2 ? 1 : -1;
+    constexpr int8_t tileStepY = Quarter == 0 || Quarter == 3 ? 1 : -1;
+    if (textureNo) {
+        const uint16_t hitX = rayX + deltaX;
+        return (hitX >> 8) - (tileStepX == -1 ? 1 : 0);
+    }
+    const uint16_t hitY = rayY + deltaY;
+    return (hitY >> 8) - (tileStepY == -1 ? 1 : 0);
+}
+
+// CalculateDistance<Quarter> without the traversal, for a ray known to hit
+// in tile (see HitTile): the intercept is advanced once per tile crossed, so
+// the results match bit for bit whenever the ray does hit there
+template <uint8_t Quarter>
+inline void ReplayHit(uint16_t rayX,
+                      uint16_t rayY,
+                      uint8_t angle,
+                      uint8_t tile,
+                      uint8_t textureNo,
+                      int16_t *deltaX,
+                      int16_t *deltaY,
+                      uint8_t *textureX)
+{
+    constexpr int8_t tileStepX = Quarter < 2 ? 1 : -1;
+    constexpr int8_t tileStepY = Quarter == 0 || Quarter == 3 ? 1 : -1;
+
+    int16_t interceptX = rayX;
+    int16_t interceptY = rayY;
+    int16_t hitX;
+    int16_t hitY;
+    if (angle != 0) {
+        const uint8_t offsetX = rayX % 256;
+        const uint8_t offsetY = rayY % 256;
+        int16_t stepX;
+        int16_t stepY;
+
+        if constexpr (tileStepX == 1) {
+            interceptY += MulTan(offsetX, true, Quarter, angle, g_cotan);
+            interceptX -= 256;
+            stepX = AbsTan(Quarter, angle, g_tan);
+        } else {
+            interceptY -= MulTan(offsetX, false, Quarter, angle, g_cotan);
+            stepX = -AbsTan(Quarter, angle, g_tan);
+        }
+
+        if constexpr (tileStepY == 1) {
+            interceptX += MulTan(offsetY, true, Quarter, angle, g_tan);
+            interceptY -= 256;
+            stepY = AbsTan(Quarter, angle, g_cotan);
+        } else {
+            interceptX -= MulTan(offsetY, false, Quarter, angle, g_tan);
+            stepY = -AbsTan(Quarter, angle, g_cotan);
+        }
+
+        if (textureNo) {
+            const uint8_t steps = (tile - (rayX >> 8)) * tileStepX;
+            interceptY += (steps - 1) * stepY;
+        } else {
+            const uint8_t steps = (tile - (rayY >> 8)) * tileStepY;
+            interceptX += (steps - 1) * stepX;
+        }
+    }
+
+    // axis-aligned rays keep their intercepts unadjusted
+    if (textureNo) {
+        hitX = (tile << 8) + (tileStepX == -1 ? 256 : 0);
+        hitY = interceptY + (tileStepY == 1 && angle != 0 ? 256 : 0);
+        *textureX = interceptY & 0xFF;
+    } else {
+        hitX = interceptX + (tileStepX == 1 && angle != 0 ? 256 : 0);
+        hitY = (tile << 8) + (tileStepY == -1 ? 256 : 0);
+        *textureX = interceptX & 0xFF;
+    }
+    *deltaX = hitX - rayX;
+    *deltaY = hitY - rayY;
+}
+
+// g_deltaAngle spread over fewer columns
+inline void ColumnAngles(uint16_t columns, uint16_t *deltaAngle)
+{
+    if (columns == SCREEN_WIDTH) {
+        std::copy(g_deltaAngle.begin(), g_deltaAngle.end(), deltaAngle);
+        return;
+    }
+    for (int i = 0; i < columns; i++) {
+        float angle =
+            atanf(((int16_t) i - columns / 2.0f) / (columns / 2.0f) * M_PI / 4);
+        int16_t da = static_cast<int16_t>(angle / M_PI_2 * 256.0f);
+        if (da < 0) {
+            da += 1024;
+        }
+        deltaAngle[i] = static_cast<uint16_t>(da);
+    }
+}
+
+// nudge rays off the angles next to the axes, which produce artefacts
+inline uint16_t NeutralizeAngle(uint16_t rayAngle)
+{
+    switch (rayAngle % 256) {
+    case 1:
+    case 254:
+        rayAngle--;
+        break;
+    case 2:
+    case 255:
+        rayAngle++;
+        break;
+    }
+    return rayAngle % 1024;
+}
+
+// distance = deltaY * cos(playerA) + deltaX * sin(playerA), with the view
+// quarter fixed
+template <uint8_t ViewQuarter>
+inline int16_t ProjectDistance(int16_t playerA,
+                               uint8_t viewAngle,
+                               int16_t deltaX,
+                               int16_t deltaY)
+{
+    int16_t distance = 0;
+    if (playerA == 0) {
+        distance += deltaY;
+    } else if (playerA == 512) {
+        distance -= deltaY;
+    } else if constexpr (ViewQuarter == 0) {
+        distance += MulS(g_cos[viewAngle], deltaY);
+    } else if constexpr (ViewQuarter == 1) {
+        distance -= MulS(g_cos[INVERT(viewAngle)], deltaY);
+    } else if constexpr (ViewQuarter == 2) {
+        distance -= MulS(g_cos[viewAngle], deltaY);
+    } else {
+        distance += MulS(g_cos[INVERT(viewAngle)], deltaY);
+    }
+
+    if (playerA == 256) {
+        distance += deltaX;
+    } else if (playerA == 768) {
+        distance -= deltaX;
+    } else if constexpr (ViewQuarter == 0) {
+        distance += MulS(g_sin[viewAngle], deltaX);
+    } else if constexpr (ViewQuarter == 1) {
+        distance += MulS(g_sin[INVERT(viewAngle)], deltaX);
+    } else if constexpr (ViewQuarter == 2) {
+        distance -= MulS(g_sin[viewAngle], deltaX);
+    } else {
+        distance -= MulS(g_sin[INVERT(viewAngle)], deltaX);
+    }
+    return distance;
+}
@@ -3,28 +3,64 @@
 #include "raycaster_float.h"
 #include <math.h>
 #include <algorithm>
+#include "door_map.h"
+#include "profiler.h"
+#include "raycaster_map.h"
 
-bool RayCasterFloat::IsWall(float rayX, float rayY)
+// material of the tile under (rayX, rayY), truncated towards zero; rays stop
+// at the border of g_tiles before they can leave it
+uint8_t RayCasterFloat::Tile(float rayX, float rayY) const
 {
-    float mapX = 0;
-    float mapY = 0;
-    float offsetX = modff(rayX, &mapX);
-    float offsetY = modff(rayY, &mapY);
-    int tileX = static_cast<int>(mapX);
-    int tileY = static_cast<int>(mapY);
-
-    if (tileX < 0 || tileY < 0 || tileX >= MAP_X - 1 || tileY >= MAP_Y - 1) {
-        return true;
+    return g_tiles[TileIndex(static_cast<int>(rayX), static_cast<int>(rayY))];
+}
+
+// whether a ray at rayA entering door tile (tileX, tileY) at (enterX,
+// enterY) stops on the door, as DoorHit in raycaster_fixed_kernels.h
+bool RayCasterFloat::DoorHit(int tileX,
+                             int tileY,
+                             float enterX,
+                             float enterY,
+                             float rayA,
+                             float *hitX,
+                             float *hitY,
+                             float *hitOffset,
+                             int *hitDirection) const
+{
+    const uint8_t door = g_doorIndex[TileIndex(tileX, tileY)];
+    const float open = (_doors != nullptr ? _doors->Open(door) : 0) / 256.0f;
+    float along;
+    if (g_doorTiles[door].vertical) {
+        const float t = (tileX + 0.5f - enterX) / sinf(rayA);
+        if (!std::isfinite(t) || t < 0) {
+            return false;
+        }
+        *hitX = tileX + 0.5f;
+        *hitY = enterY + t * cosf(rayA);
+        along = *hitY - tileY;
+        *hitDirection = 1;
+    } else {
+        const float t = (tileY + 0.5f - enterY) / cosf(rayA);
+        if (!std::isfinite(t) || t < 0) {
+            return false;
+        }
+        *hitX = enterX + t * sinf(rayA);
+        *hitY = tileY + 0.5f;
+        along = *hitX - tileX;
+        *hitDirection = 0;
     }
-    return g_map[(tileX >> 3) + (tileY << (MAP_XS - 3))] &
-           (1 << (8 - (tileX & 0x7)));
+    if (along < open || along >= 1) {
+        return false;
+    }
+    *hitOffset = along - open;
+    return true;
 }
 
 float RayCasterFloat::Distance(float playerX,
                                float playerY,
                                float rayA,
                                float *hitOffset,
-                               int *hitDirection)
+                               int *hitDirection,
+                               uint8_t *material) const
 {
     while (rayA < 0) {
         rayA += 2.0f * M_PI;
@@ -71,6 +107,7 @@ float RayCasterFloat::Distance(float playerX,
     bool verticalHit = false;
     bool horizontalHit = false;
     bool somethingDone = false;
+    *material = 0;
 
     do {
         somethingDone = false;
@@ -78,8 +115,20 @@ float RayCasterFloat::Distance(float playerX,
                 (tileStepY == -1 && (interceptY >= tileY)))) {
             somethingDone = true;
             tileX += tileStepX;
-            if (IsWall(tileX, interceptY)) {
+            const uint8_t tile = Tile(tileX, interceptY);
+            PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+            if (tile == MATERIAL_DOOR) {
+                PROFILE_COUNT(PROFILE_DOOR_TESTS, 1);
+                if (DoorHit(tileX, interceptY,
+                            tileX + (tileStepX == -1 ? 1 : 0), interceptY,
+                            rayA, &rayX, &rayY, hitOffset, hitDirection)) {
+                    verticalHit = true;
+                    *material = tile;
+                    break;
+                }
+            } else if (tile != 0) {
                 verticalHit = true;
+                *material = tile;
                 rayX = tileX + (tileStepX == -1 ? 1 : 0);
                 rayY = interceptY;
                 *hitOffset = interceptY;
@@ -92,8 +141,20 @@ float RayCasterFloat::Distance(float playerX,
                                 (tileStepX == -1 && (interceptX >= tileX)))) {
             somethingDone = true;
             tileY += tileStepY;
-            if (IsWall(interceptX, tileY)) {
+            const uint8_t tile = Tile(interceptX, tileY);
+            PROFILE_COUNT(PROFILE_DDA_STEPS, 1);
+            if (tile == MATERIAL_DOOR) {
+                PROFILE_COUNT(PROFILE_DOOR_TESTS, 1);
+                if (DoorHit(interceptX, tileY, interceptX,
+                            tileY + (tileStepY == -1 ? 1 : 0), rayA, &rayX,
+                            &rayY, hitOffset, hitDirection)) {
+                    horizontalHit = true;
+                    *material = tile;
+                    break;
+                }
+            } else if (tile != 0) {
                 horizontalHit = true;
+                *material = tile;
                 rayX = interceptX;
                 *hitOffset = interceptX;
                 *hitDirection = 0;
@@ -113,22 +174,27 @@ float RayCasterFloat::Distance(float playerX,
     return sqrt(deltaX * deltaX + deltaY * deltaY);
 }
 
-RayCasterFloat::TraceResult RayCasterFloat::Trace(uint16_t screenX)
+RayCasterFloat::TraceResult RayCasterFloat::TraceRay(float playerX,
+                                                     float playerY,
+                                                     float playerA,
+                                                     uint16_t columns,
+                                                     uint16_t screenX) const
 {
     TraceResult res;
     float hitOffset;
     int hitDirection;
-    float deltaAngle =
-        atanf(((int16_t) screenX - SCREEN_WIDTH / 2.0f) /
-              (SCREEN_WIDTH / 2.0f) * M_PI / 4);  // FOV = 2 * tan^-1(PI/4)
-    float lineDistance = Distance(_playerX, _playerY, _playerA + deltaAngle,
-                                  &hitOffset, &hitDirection);
+    float deltaAngle = atanf(((int16_t) screenX - columns / 2.0f) /
+                             (columns / 2.0f) * M_PI /
+                             4);  // FOV = 2 * tan^-1(PI/4)
+    float lineDistance = Distance(playerX, playerY, playerA + deltaAngle,
+                                  &hitOffset, &hitDirection, &res.material);
     float distance = lineDistance * cos(deltaAngle);
     float dum;
     res.textureNo = hitDirection;
     res.textureX = (uint8_t)(256.0f * modff(hitOffset, &dum));
     res.textureY = 0;
     res.textureStep = 0;
+    res.distance = std::min(distance * 256.0f, 65535.0f);
     if (distance > 0) {
         res.screenY = std::min<int>(INV_FACTOR / distance, SCREEN_HEIGHT / 2);
         auto txs = (INV_FACTOR / distance * 2.0f);
@@ -141,11 +207,51 @@ RayCasterFloat::TraceResult RayCasterFloat::Trace(uint16_t screenX)
         }
     } else {
         res.screenY = 0;
+        res.distance = 0xFFFF;
     }
     return res;
 }
 
-void RayCasterFloat::Start(uint16_t playerX, uint16_t playerY, int16_t playerA)
+RayCasterFloat::TraceResult RayCasterFloat::Trace(uint16_t screenX)
+{
+    return TraceRay(_playerX, _playerY, _playerA, _columns, screenX);
+}
+
+void RayCasterFloat::TraceColumns(uint16_t first,
+                                  uint16_t count,
+                                  TraceBatch *out) const
+{
+    const float playerX = _playerX;
+    const float playerY = _playerY;
+    const float playerA = _playerA;
+    const uint16_t columns = _columns;
+
+    for (uint16_t x = first; x < first + count; x++) {
+        const auto res = TraceRay(playerX, playerY, playerA, columns, x);
+        out->screenY[x] = res.screenY;
+        out->textureNo[x] = res.textureNo;
+        out->textureX[x] = res.textureX;
+        out->textureY[x] = res.textureY;
+        out->textureStep[x] = res.textureStep;
+        out->material[x] = res.material;
+        out->distance[x] = res.distance;
+    }
+}
+
+void RayCasterFloat::SetColumns(uint16_t columns)
+{
+    _columns = columns;
+}
+
+std::unique_ptr<RayCaster> RayCasterFloat::Clone() const
+{
+    std::unique_ptr<RayCasterFloat> clone(new RayCasterFloat());
+    clone->SetColumns(_columns);
+    clone->SetDoors(_doors);
+    return clone;
+}
+
+void RayCasterFloat::Start(uint32_t playerX, uint32_t playerY, int16_t playerA)
 {
     _playerX = (playerX / 1024.0f) * 4.0f;
     _playerY = (playerY / 1024.0f) * 4.0f;
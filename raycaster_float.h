@@ -5,8 +5,21 @@
 class RayCasterFloat : public RayCaster
 {
 public:
-    void Start(uint16_t playerX, uint16_t playerY, int16_t playerA) override;
+    void Start(uint32_t playerX, uint32_t playerY, int16_t playerA) override;
     TraceResult Trace(uint16_t screenX) override;
+    void TraceColumns(uint16_t first,
+                      uint16_t count,
+                      TraceBatch *out) const override;
+    void SetColumns(uint16_t columns) override;
+    void SetDoors(const DoorMap *doors) override { _doors = doors; }
+    std::unique_ptr<RayCaster> Clone() const override;
+
+    float Distance(float playerX,
+                   float playerY,
+                   float rayA,
+                   float *hitOffset,
+                   int *hitDirection,
+                   uint8_t *material) const;
 
     RayCasterFloat();
     ~RayCasterFloat();
@@ -15,11 +28,22 @@ private:
     float _playerX;
     float _playerY;
     float _playerA;
+    uint16_t _columns = SCREEN_WIDTH;
+    const DoorMap *_doors = nullptr;
 
-    float Distance(float playerX,
-                   float playerY,
-                   float rayA,
-                   float *hitOffset,
-                   int *hitDirection);
-    bool IsWall(float rayX, float rayY);
+    uint8_t Tile(float rayX, float rayY) const;
+    bool DoorHit(int tileX,
+                 int tileY,
+                 float enterX,
+                 float enterY,
+                 float rayA,
+                 float *hitX,
+                 float *hitY,
+                 float *hitOffset,
+                 int *hitDirection) const;
+    TraceResult TraceRay(float playerX,
+                         float playerY,
+                         float playerA,
+                         uint16_t columns,
+                         uint16_t screenX) const;
 };
@@ -0,0 +1,79 @@
+#pragma once
+// g_map as one byte per tile with a solid border around it, so the casters
+// read a tile's material without bounds checks or bit extraction
+
+#include <stdint.h>
+#include <array>
+#include "raycaster.h"
+#include "raycaster_data.h"
+
+// tile materials, 0 is open
+#define MATERIAL_WALL 1
+#define MATERIAL_BORDER 2
+#define MATERIAL_PILLAR 3
+#define MATERIAL_DOOR 4
+#define MATERIAL_COUNT 5
+
+#define TILES_STRIDE (MAP_X + 2)
+
+// tiles -1 to MAP_X by -1 to MAP_Y; as uint8_t, tile -1 wraps to 255 and still
+// lands on the border. Every ray stops at the border, so positions must be
+// inside the map
+constexpr uint16_t TileIndex(uint8_t tileX, uint8_t tileY)
+{
+    return static_cast<uint8_t>(tileY + 1) * TILES_STRIDE +
+           static_cast<uint8_t>(tileX + 1);
+}
+
+// sliding doors, set in doorways of g_map. A door is a plane through the
+// middle of its tile, across y for horizontal doors and across x for
+// vertical ones, drawn where the ray crosses it at least its open amount
+// along the plane from the low edge of the tile
+#define DOOR_COUNT 5
+// open amount of a door fully open, in 1/256 tiles
+#define DOOR_OPEN 256
+
+struct DoorTile {
+    uint8_t x;
+    uint8_t y;
+    bool vertical;
+};
+
+inline constexpr DoorTile g_doorTiles[DOOR_COUNT] = {
+    {8, 12, false}, {16, 12, false}, {24, 12, false},
+    {16, 1, false}, {9, 3, true},
+};
+
+inline constexpr auto g_tiles = []() constexpr
+{
+    std::array<uint8_t, TILES_STRIDE * (MAP_Y + 2)> tiles{};
+    for (int y = -1; y <= MAP_Y; y++) {
+        for (int x = -1; x <= MAP_X; x++) {
+            uint8_t material = 0;
+            if (x < 0 || y < 0 || x == MAP_X || y == MAP_Y) {
+                material = MATERIAL_BORDER;
+            } else if (g_map[(x >> 3) + (y << (MAP_XS - 3))] &
+                       (1 << (8 - (x & 0x7)))) {
+                // the bits the old bitmap lookup tested
+                material = MATERIAL_WALL;
+            }
+            tiles[TileIndex(x, y)] = material;
+        }
+    }
+    for (const auto &door : g_doorTiles) {
+        tiles[TileIndex(door.x, door.y)] = MATERIAL_DOOR;
+    }
+    return tiles;
+}
+();
+
+// index into g_doorTiles of each MATERIAL_DOOR tile
+inline constexpr auto g_doorIndex = []() constexpr
+{
+    std::array<uint8_t, TILES_STRIDE * (MAP_Y + 2)> index{};
+    for (int i = 0; i < DOOR_COUNT; i++) {
+        index[TileIndex(g_doorTiles[i].x, g_doorTiles[i].y)] = i;
+    }
+    return index;
+}
+();
@@ -0,0 +1,429 @@
+#include "render_server.h"
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+
+// bytes read from a client at a time
+#define RECEIVE_SIZE 65536
+// response bytes a client may leave unread before it is dropped, more than
+// the largest response
+#define SEND_BACKLOG (128 << 20)
+
+// as much as the socket takes without blocking, or -1 once the client is
+// gone; without SIGPIPE from clients that hung up
+static ssize_t SendSome(int fd, const iovec *iov, int count)
+{
+    msghdr message = {};
+    message.msg_iov = const_cast<iovec *>(iov);
+    message.msg_iovlen = count;
+    for (;;) {
+        const ssize_t n = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+static size_t PoseBytes(uint16_t kind)
+{
+    return kind == RENDER_FRAMES
+               ? SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t)
+               : sizeof(RayCaster::TraceBatch);
+}
+
+void RenderServer::Run()
+{
+    _reported = Clock::now();
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({_wake[0], POLLIN, 0});
+        fds.push_back({_listener, POLLIN, 0});
+        for (const auto &c : _clients) {
+            const short out = c.output.size() > c.sent ? POLLOUT : 0;
+            fds.push_back({c.fd, static_cast<short>(POLLIN | out), 0});
+        }
+        // only wait while there is nothing to render
+        const int timeout = !_pending.empty() ? 0 : _report ? 1000 : -1;
+        if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            return;
+        }
+        if (fds[0].revents) {
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            Accept();
+        }
+        for (size_t i = 2; i < fds.size(); i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            Client *client = Find(fds[i].fd);
+            if (client == nullptr) {
+                continue;
+            }
+            if (((fds[i].revents & POLLOUT) && !Flush(client)) ||
+                ((fds[i].revents & ~POLLOUT) && !Receive(client))) {
+                Drop(fds[i].fd);
+            }
+        }
+        if (!_pending.empty()) {
+            RenderBatch();
+        }
+        if (_report) {
+            Report();
+        }
+    }
+}
+
+void RenderServer::Stop()
+{
+    const char stop = 0;
+    if (write(_wake[1], &stop, 1) < 0) {
+        // the pipe is full, a stop is pending already
+    }
+}
+
+void RenderServer::Accept()
+{
+    const int fd =
+        accept4(_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0) {
+        _clients.push_back({fd, {}, {}, 0});
+    }
+}
+
+bool RenderServer::Receive(Client *client)
+{
+    auto &input = client->input;
+    const size_t size = input.size();
+    input.resize(size + RECEIVE_SIZE);
+    const ssize_t n = read(client->fd, input.data() + size, RECEIVE_SIZE);
+    input.resize(size + std::max<ssize_t>(n, 0));
+    if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) {
+        return false;
+    }
+
+    size_t used = 0;
+    while (input.size() - used >= sizeof(RenderRequest)) {
+        Pending p;
+        memcpy(&p.request, input.data() + used, sizeof(p.request));
+        if (p.request.magic != RENDER_MAGIC) {
+            return false;
+        }
+        const size_t bytes =
+            sizeof(RenderRequest) + p.request.count * sizeof(RenderPose);
+        if (input.size() - used < bytes) {
+            break;
+        }
+        p.fd = client->fd;
+        p.arrived = Clock::now();
+        p.poses.resize(p.request.count);
+        memcpy(p.poses.data(), input.data() + used + sizeof(RenderRequest),
+               p.request.count * sizeof(RenderPose));
+        used += bytes;
+        if ((p.request.kind != RENDER_FRAMES &&
+             p.request.kind != RENDER_TRACE) ||
+            p.request.count > RENDER_MAX_POSES) {
+            if (!Reply(client, p, -1, 0, nullptr, 0)) {
+                return false;
+            }
+            continue;
+        }
+        _queuedPoses += p.poses.size();
+        _pending.push_back(std::move(p));
+    }
+    input.erase(input.begin(), input.begin() + used);
+    return true;
+}
+
+bool RenderServer::Flush(Client *client)
+{
+    auto &output = client->output;
+    const iovec iov = {output.data() + client->sent,
+                       output.size() - client->sent};
+    const ssize_t n = SendSome(client->fd, &iov, 1);
+    if (n < 0) {
+        return false;
+    }
+    client->sent += n;
+    if (client->sent == output.size()) {
+        output.clear();
+        output.shrink_to_fit();
+        client->sent = 0;
+    }
+    return true;
+}
+
+RenderServer::Client *RenderServer::Find(int fd)
+{
+    auto client =
+        std::find_if(_clients.begin(), _clients.end(),
+                     [fd](const Client &c) { return c.fd == fd; });
+    return client != _clients.end() ? &*client : nullptr;
+}
+
+void RenderServer::Drop(int fd)
+{
+    close(fd);
+    _clients.erase(std::remove_if(_clients.begin(), _clients.end(),
+                                  [fd](const Client &c) { return c.fd == fd; }),
+                   _clients.end());
+    // a later client may get the same fd back
+    auto gone = std::remove_if(_pending.begin(), _pending.end(),
+                               [fd](const Pending &p) { return p.fd == fd; });
+    for (auto p = gone; p != _pending.end(); p++) {
+        _queuedPoses -= p->poses.size();
+    }
+    _pending.erase(gone, _pending.end());
+}
+
+void RenderServer::RenderBatch()
+{
+    // whole requests in order of arrival, as many as fit the batch
+    size_t requests = 0;
+    size_t poses = 0;
+    size_t bytes = 0;
+    while (requests < _pending.size()) {
+        const Pending &p = _pending[requests];
+        if (requests > 0 && poses + p.poses.size() > RENDER_BATCH) {
+            break;
+        }
+        poses += p.poses.size();
+        bytes += p.poses.size() * PoseBytes(p.request.kind);
+        requests++;
+    }
+    const size_t depth = _queuedPoses;
+    AddCameras(poses);
+    _payload.resize(bytes);
+
+    // camera i traces pose i of the batch, into its place in the payload
+    struct Trace {
+        size_t camera;
+        const RenderPose *pose;
+        uint8_t *out;
+    };
+    std::vector<Camera<uint32_t>> cameras;
+    std::vector<Trace> traces;
+    uint8_t *out = _payload.data();
+    size_t camera = 0;
+    for (size_t r = 0; r < requests; r++) {
+        const Pending &p = _pending[r];
+        for (const auto &pose : p.poses) {
+            if (p.request.kind == RENDER_FRAMES) {
+                const RenderTarget<uint32_t> target = {
+                    reinterpret_cast<uint32_t *>(out)};
+                cameras.push_back({_renderers[camera].get(), pose.x, pose.y,
+                                   pose.a, target});
+            } else {
+                traces.push_back({camera, &pose, out});
+            }
+            out += PoseBytes(p.request.kind);
+            camera++;
+        }
+    }
+    if (!cameras.empty()) {
+        Renderer::TraceFrames(&_game, cameras.data(), cameras.size(), _pool);
+    }
+    // as Renderer starts its caster
+    const auto trace = [this, &traces](int t) {
+        const Trace &trace = traces[t];
+        RayCaster *rc = _casters[trace.camera].get();
+        rc->SetDoors(&_game.doors);
+        rc->Start(static_cast<uint32_t>(trace.pose->x * 256.0f),
+                  static_cast<uint32_t>(trace.pose->y * 256.0f),
+                  static_cast<int16_t>(trace.pose->a / (2.0f * M_PI) *
+                                       1024.0f));
+        rc->TraceColumns(0, SCREEN_WIDTH,
+                         reinterpret_cast<RayCaster::TraceBatch *>(trace.out));
+    };
+    if (_pool == nullptr) {
+        for (size_t t = 0; t < traces.size(); t++) {
+            trace(t);
+        }
+    } else if (!traces.empty()) {
+        _pool->Run(traces.size(), trace);
+    }
+
+    // clients that hang up are dropped once the batch is answered
+    std::vector<int> gone;
+    out = _payload.data();
+    for (size_t r = 0; r < requests; r++) {
+        const Pending &p = _pending[r];
+        const size_t size = p.poses.size() * PoseBytes(p.request.kind);
+        Client *client = Find(p.fd);
+        if (client != nullptr &&
+            std::find(gone.begin(), gone.end(), p.fd) == gone.end() &&
+            !Reply(client, p, 0, depth, out, size)) {
+            gone.push_back(p.fd);
+        }
+        out += size;
+    }
+    _pending.erase(_pending.begin(), _pending.begin() + requests);
+    _queuedPoses -= poses;
+    _batches++;
+    _depth += depth;
+    _maxDepth = std::max(_maxDepth, depth);
+    for (const int fd : gone) {
+        Drop(fd);
+    }
+}
+
+bool RenderServer::Reply(Client *client,
+                         const Pending &p,
+                         int32_t status,
+                         uint32_t queued,
+                         const uint8_t *payload,
+                         size_t bytes)
+{
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - p.arrived).count();
+    RenderResponse response;
+    response.magic = RENDER_MAGIC;
+    response.id = p.request.id;
+    response.kind = p.request.kind;
+    response.count = p.request.count;
+    response.status = status;
+    response.queued = queued;
+    response.latencyMicroseconds = seconds * 1e6;
+    response.bytes = bytes;
+    iovec iov[2] = {{&response, sizeof(response)},
+                    {const_cast<uint8_t *>(payload), bytes}};
+    _requests++;
+    _latency += seconds;
+    _maxLatency = std::max(_maxLatency, seconds);
+    return Send(client, iov, bytes > 0 ? 2 : 1);
+}
+
+bool RenderServer::Send(Client *client, const iovec *iov, int count)
+{
+    auto &output = client->output;
+    // straight to the socket unless earlier responses are still queued
+    size_t skip = 0;
+    if (output.size() == client->sent) {
+        const ssize_t n = SendSome(client->fd, iov, count);
+        if (n < 0) {
+            return false;
+        }
+        skip = n;
+    }
+    output.erase(output.begin(), output.begin() + client->sent);
+    client->sent = 0;
+    for (int i = 0; i < count; i++) {
+        const auto *data = static_cast<const uint8_t *>(iov[i].iov_base);
+        const size_t from = std::min(skip, iov[i].iov_len);
+        output.insert(output.end(), data + from, data + iov[i].iov_len);
+        skip -= from;
+    }
+    return output.size() <= SEND_BACKLOG;
+}
+
+void RenderServer::Report()
+{
+    const auto now = Clock::now();
+    if (now - _reported < std::chrono::seconds(1)) {
+        return;
+    }
+    if (_requests > 0) {
+        fprintf(stderr,
+                "%llu requests in %llu batches, latency mean %.2f ms max "
+                "%.2f ms, queue depth mean %.1f max %zu poses\n",
+                static_cast<unsigned long long>(_requests),
+                static_cast<unsigned long long>(_batches),
+                _latency / _requests * 1000.0, _maxLatency * 1000.0,
+                _batches > 0 ? _depth / static_cast<double>(_batches) : 0.0,
+                _maxDepth);
+    }
+    _reported = now;
+    _requests = 0;
+    _batches = 0;
+    _latency = 0;
+    _maxLatency = 0;
+    _depth = 0;
+    _maxDepth = 0;
+}
+
+void RenderServer::AddCameras(size_t count)
+{
+    while (_renderers.size() < count) {
+        _casters.push_back(_caster->Clone());
+        _renderers.emplace_back(new Renderer(_casters.back().get(), _pool));
+        _renderers.back()->SetTexturedFloor(_texturedFloor);
+        _renderers.back()->SetShading(_shading);
+    }
+}
+
+void RenderServer::SetTexturedFloor(bool texturedFloor)
+{
+    _texturedFloor = texturedFloor;
+    for (auto &r : _renderers) {
+        r->SetTexturedFloor(texturedFloor);
+    }
+}
+
+void RenderServer::SetShading(const Shading *shading)
+{
+    _shading = shading;
+    for (auto &r : _renderers) {
+        r->SetShading(shading);
+    }
+}
+
+std::unique_ptr<RenderServer> RenderServer::Listen(const char *path,
+                                                   const RayCaster &caster,
+                                                   ThreadPool *pool)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return nullptr;
+    }
+    strcpy(address.sun_path, path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    unlink(path);
+    int wake[2];
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) ||
+        listen(fd, SOMAXCONN) || pipe(wake)) {
+        close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<RenderServer> server(new RenderServer(fd, wake, path));
+    server->_caster = &caster;
+    server->_pool = pool;
+    return server;
+}
+
+RenderServer::RenderServer(int listener, int wake[2], const char *path)
+    : _listener(listener), _wake{wake[0], wake[1]}, _path(path)
+{
+}
+
+RenderServer::~RenderServer()
+{
+    for (const auto &c : _clients) {
+        close(c.fd);
+    }
+    close(_listener);
+    close(_wake[0]);
+    close(_wake[1]);
+    unlink(_path.c_str());
+}
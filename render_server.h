@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "raycaster.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+// the wire format, in host byte order as the socket is local: a
+// RenderRequest followed by count RenderPoses, answered by a RenderResponse
+// followed by count frames of ARGB pixels or count RayCaster::TraceBatches
+#define RENDER_MAGIC 0x444e4552
+#define RENDER_MAX_POSES 256
+// poses rendered together, requests are not split to fill a batch
+#define RENDER_BATCH 32
+
+enum RenderKind {
+    RENDER_FRAMES,  // SCREEN_WIDTH x SCREEN_HEIGHT ARGB frames
+    RENDER_TRACE,   // the traced columns only, for clients after depth
+};
+
+struct RenderPose {
+    // as Game's player
+    float x;
+    float y;
+    float a;
+};
+
+struct RenderRequest {
+    uint32_t magic;
+    // echoed in the response
+    uint32_t id;
+    uint16_t kind;
+    uint16_t count;
+};
+
+struct RenderResponse {
+    uint32_t magic;
+    uint32_t id;
+    uint16_t kind;
+    uint16_t count;
+    // 0, or -1 for a request of an unknown kind or too many poses, which
+    // comes without payload
+    int32_t status;
+    // poses waiting, this request's included, when its batch began
+    uint32_t queued;
+    // from the request arriving to the response going out
+    uint32_t latencyMicroseconds;
+    // payload bytes that follow
+    uint32_t bytes;
+};
+
+// renders camera poses for other local processes over a Unix domain
+// socket. Everything that arrives while a batch renders is coalesced into
+// the next one, whose frames are traced by Renderer::TraceFrames and whose
+// column traces are spread over the pool a pose per task
+class RenderServer
+{
+public:
+    // listens on path, replacing any socket left there; nullptr if it
+    // can't. Cameras trace clones of caster
+    static std::unique_ptr<RenderServer> Listen(const char *path,
+                                                const RayCaster &caster,
+                                                ThreadPool *pool);
+
+    // serves clients until Stop
+    void Run();
+    // safe to call from a signal handler or another thread
+    void Stop();
+
+    // frames are rendered with these, all cameras alike
+    void SetTexturedFloor(bool texturedFloor);
+    void SetShading(const Shading *shading);
+
+    // per second on stderr while serving: requests, their latency and the
+    // queue depth batches began with
+    void SetReport(bool report) { _report = report; }
+
+    ~RenderServer();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Client {
+        int fd;
+        // bytes received and not parsed yet
+        std::vector<uint8_t> input;
+        // responses the socket didn't take yet, from sent on
+        std::vector<uint8_t> output;
+        size_t sent;
+    };
+    struct Pending {
+        int fd;
+        RenderRequest request;
+        std::vector<RenderPose> poses;
+        Clock::time_point arrived;
+    };
+
+    RenderServer(int listener, int wake[2], const char *path);
+    void Accept();
+    // false once the client is gone or broke the protocol
+    bool Receive(Client *client);
+    // what the socket takes of the queued responses; false once the client
+    // is gone
+    bool Flush(Client *client);
+    Client *Find(int fd);
+    void Drop(int fd);
+    void RenderBatch();
+    // false once the client is gone or left too much unread. Responses are
+    // queued behind what the client hasn't read yet, so one that stops
+    // reading holds up no one else
+    bool Reply(Client *client,
+               const Pending &p,
+               int32_t status,
+               uint32_t queued,
+               const uint8_t *payload,
+               size_t bytes);
+    // what the socket takes of iov, the rest queued
+    bool Send(Client *client, const iovec *iov, int count);
+    void Report();
+    // at least count cameras
+    void AddCameras(size_t count);
+
+    int _listener;
+    int _wake[2];
+    std::string _path;
+    const RayCaster *_caster = nullptr;
+    ThreadPool *_pool = nullptr;
+    bool _texturedFloor = false;
+    const Shading *_shading = &Shading::Default();
+    std::vector<Client> _clients;
+    std::vector<Pending> _pending;
+    size_t _queuedPoses = 0;
+    // a caster and renderer per pose of the largest batch so far
+    std::vector<std::unique_ptr<RayCaster>> _casters;
+    std::vector<std::unique_ptr<Renderer>> _renderers;
+    std::vector<uint8_t> _payload;
+    Game _game;
+
+    bool _report = false;
+    Clock::time_point _reported;
+    uint64_t _requests = 0;
+    uint64_t _batches = 0;
+    double _latency = 0;
+    double _maxLatency = 0;
+    uint64_t _depth = 0;
+    size_t _maxDepth = 0;
+};
@@ -1,51 +1,622 @@
 #include "renderer.h"
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "profiler.h"
 #include "raycaster_data.h"
+#include "raycaster_map.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// side of the blocks the column-major frame is transposed in
+#define TRANSPOSE_BLOCK 16
+// rows cast per thread pool task
+#define ROW_BAND 16
+
+static_assert(SCREEN_WIDTH % TRANSPOSE_BLOCK == 0 &&
+                  SCREEN_HEIGHT % TRANSPOSE_BLOCK == 0,
+              "the frame must split into transpose blocks");
+
+// plain grey for ordinary walls
+static const uint8_t g_materialRamp[MATERIAL_COUNT] = {
+    RAMP_GREY,  // open, only seen when a ray hits nothing
+    RAMP_GREY,  // MATERIAL_WALL
+    RAMP_BORDER,
+    RAMP_PILLAR,
+    RAMP_DOOR,
+};
+
+// pixels first to end of row from texture through shade, at 16.16 tile
+// coordinates (u, v) for pixel 0 and stepping (du, dv) per pixel
+template <typename Pixel>
+static void FillSpan(Pixel *row,
+                     int first,
+                     int end,
+                     uint32_t u,
+                     uint32_t v,
+                     uint32_t du,
+                     uint32_t dv,
+                     const uint8_t *texture,
+                     const Pixel *shade)
+{
+    int x = first;
+    u += first * du;
+    v += first * dv;
+#ifdef __SSE2__
+    // texel indices 4 at a time, the fetches stay scalar
+    const __m128i mask = _mm_set1_epi32(63);
+    const __m128i du4 = _mm_set1_epi32(4 * du);
+    const __m128i dv4 = _mm_set1_epi32(4 * dv);
+    __m128i us = _mm_setr_epi32(u, u + du, u + 2 * du, u + 3 * du);
+    __m128i vs = _mm_setr_epi32(v, v + dv, v + 2 * dv, v + 3 * dv);
+    alignas(16) uint32_t texel[4];
+    for (; x + 4 <= end; x += 4) {
+        const __m128i tx = _mm_and_si128(_mm_srli_epi32(us, 10), mask);
+        const __m128i ty = _mm_and_si128(_mm_srli_epi32(vs, 10), mask);
+        _mm_store_si128(reinterpret_cast<__m128i *>(texel),
+                        _mm_or_si128(_mm_slli_epi32(ty, 6), tx));
+        const Pixel pixels[4] = {
+            shade[texture[texel[0]]], shade[texture[texel[1]]],
+            shade[texture[texel[2]]], shade[texture[texel[3]]]};
+        memcpy(row + x, pixels, sizeof(pixels));
+        us = _mm_add_epi32(us, du4);
+        vs = _mm_add_epi32(vs, dv4);
+    }
+    u = _mm_cvtsi128_si32(us);
+    v = _mm_cvtsi128_si32(vs);
+#endif
+    for (; x < end; x++) {
+        row[x] = shade[texture[((v >> 10) & 63) << 6 | ((u >> 10) & 63)]];
+        u += du;
+        v += dv;
+    }
+}
+
+// 4 pixels of 4 columns to 4 pixels of 4 rows, pitch pixels apart
+template <typename Pixel>
+static inline void Transpose4x4(const Pixel *columns,
+                                Pixel *rows,
+                                size_t pitch)
+{
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            rows[y * pitch + x] = columns[x * SCREEN_HEIGHT + y];
+        }
+    }
+}
+
+#ifdef __SSE2__
+template <>
+inline void Transpose4x4(const uint32_t *columns,
+                         uint32_t *rows,
+                         size_t pitch)
+{
+    const __m128i c0 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(columns));
+    const __m128i c1 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(columns + SCREEN_HEIGHT));
+    const __m128i c2 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(columns + 2 * SCREEN_HEIGHT));
+    const __m128i c3 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(columns + 3 * SCREEN_HEIGHT));
+    const __m128i t0 = _mm_unpacklo_epi32(c0, c1);
+    const __m128i t1 = _mm_unpacklo_epi32(c2, c3);
+    const __m128i t2 = _mm_unpackhi_epi32(c0, c1);
+    const __m128i t3 = _mm_unpackhi_epi32(c2, c3);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rows),
+                     _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rows + pitch),
+                     _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rows + 2 * pitch),
+                     _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rows + 3 * pitch),
+                     _mm_unpackhi_epi64(t2, t3));
+}
+#endif
+
+// rows first to first + TRANSPOSE_BLOCK of fb, a block at a time so both
+// sides stay in L1
+template <typename Pixel>
+static void TransposeRows(const Pixel *columns,
+                          Pixel *fb,
+                          size_t pitch,
+                          int first)
+{
+    for (int bx = 0; bx < SCREEN_WIDTH; bx += TRANSPOSE_BLOCK) {
+        for (int y = first; y < first + TRANSPOSE_BLOCK; y += 4) {
+            for (int x = bx; x < bx + TRANSPOSE_BLOCK; x += 4) {
+                Transpose4x4(columns + x * SCREEN_HEIGHT + y,
+                             fb + y * pitch + x, pitch);
+            }
+        }
+    }
+}
+
+const uint32_t *Renderer::Palette()
+{
+    return Shading::Palette();
+}
+
+void Renderer::ExpandIndexed(const uint8_t *indexed,
+                             uint32_t *frameBuffer,
+                             size_t count)
+{
+    // SSE2 has no gather, a table lookup per pixel is as good as it gets
+    for (size_t i = 0; i < count; i++) {
+        frameBuffer[i] = Shading::Palette()[indexed[i]];
+    }
+}
+
+void Renderer::ExpandIndexed(const RenderTarget<uint8_t> &indexed,
+                             const RenderTarget<uint32_t> &target)
+{
+    auto *to = reinterpret_cast<uint8_t *>(target.pixels);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        ExpandIndexed(indexed.pixels + y * indexed.pitch,
+                      reinterpret_cast<uint32_t *>(to + y * target.pitch),
+                      SCREEN_WIDTH);
+    }
+}
+
+void Renderer::SetColumnMajor(bool columnMajor)
+{
+    if (columnMajor) {
+        _columnMajor.resize(SCREEN_WIDTH * SCREEN_HEIGHT);
+    } else {
+        _columnMajor.clear();
+        _columnMajor.shrink_to_fit();
+    }
+}
 
 void Renderer::TraceFrame(Game *g, uint32_t *fb)
 {
-    _rc->Start(static_cast<uint16_t>(g->playerX * 256.0f),
-               static_cast<uint16_t>(g->playerY * 256.0f),
-               static_cast<int16_t>(g->playerA / (2.0f * M_PI) * 1024.0f));
+    TraceFrame(g, RenderTarget<uint32_t>{fb});
+}
+
+void Renderer::TraceFrame(Game *g, const RenderTarget<uint32_t> &target)
+{
+    const Camera<uint32_t> camera = {this, g->playerX, g->playerY,
+                                     g->playerA, target};
+    RenderBatch(g, &camera, 1, _pool);
+}
+
+void Renderer::TraceFrame(Game *g, uint8_t *fb)
+{
+    TraceFrame(g, RenderTarget<uint8_t>{fb});
+}
+
+void Renderer::TraceFrame(Game *g, const RenderTarget<uint8_t> &target)
+{
+    const Camera<uint8_t> camera = {this, g->playerX, g->playerY,
+                                    g->playerA, target};
+    RenderBatch(g, &camera, 1, _pool);
+}
+
+void Renderer::TraceFrames(Game *g,
+                           const Camera<uint32_t> *cameras,
+                           size_t count,
+                           ThreadPool *pool)
+{
+    RenderBatch(g, cameras, count, pool);
+}
+
+void Renderer::TraceFrames(Game *g,
+                           const Camera<uint8_t> *cameras,
+                           size_t count,
+                           ThreadPool *pool)
+{
+    RenderBatch(g, cameras, count, pool);
+}
+
+// each pass runs the tasks of every camera in one pool run, numbered camera
+// after camera
+template <typename Pixel>
+void Renderer::RenderBatch(Game *g,
+                           const Camera<Pixel> *cameras,
+                           size_t count,
+                           ThreadPool *pool)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        cameras[i].renderer->Begin(g, cameras[i]);
+    }
+
+    const Camera<Pixel> *end = cameras + count;
+    for (int p = 0; p < PASS_COUNT; p++) {
+        const Pass pass = static_cast<Pass>(p);
+        int tasks = 0;
+        for (size_t i = 0; i < count; i++) {
+            Renderer *r = cameras[i].renderer;
+            r->_batchFirst = tasks;
+            tasks += r->Tasks(pass);
+            r->_batchEnd = tasks;
+        }
+        const auto byEnd = [](int task, const Camera<Pixel> &c) {
+            return task < c.renderer->_batchEnd;
+        };
+        const auto run = [cameras, end, pass, byEnd](int task) {
+            Renderer *r =
+                std::upper_bound(cameras, end, task, byEnd)->renderer;
+            r->RunTask<Pixel>(pass, task - r->_batchFirst);
+        };
+        if (pool == nullptr) {
+            for (int task = 0; task < tasks; task++) {
+                run(task);
+            }
+        } else if (tasks > 0) {
+            pool->Run(tasks, run);
+        }
+    }
+
+    const std::chrono::duration<float> seconds =
+        std::chrono::steady_clock::now() - start;
+    for (size_t i = 0; i < count; i++) {
+        if (cameras[i].renderer->_governor != nullptr) {
+            cameras[i].renderer->_governor->Update(seconds.count());
+        }
+    }
+}
+
+template <typename Pixel>
+void Renderer::Begin(Game *g, const Camera<Pixel> &camera)
+{
+    const uint16_t columns =
+        _governor != nullptr ? _governor->Columns() : SCREEN_WIDTH;
+    if (columns != _columns) {
+        _columns = columns;
+        _rc->SetColumns(columns);
+    }
 
-    for (int x = 0; x < SCREEN_WIDTH; x++) {
-        uint32_t *lb = fb + x;
+    _playerX = camera.x;
+    _playerY = camera.y;
+    _playerA = camera.a;
+    _rc->SetDoors(&g->doors);
+    {
+        PROFILE_SCOPE(PROFILE_START);
+        _rc->Start(static_cast<uint32_t>(camera.x * 256.0f),
+                   static_cast<uint32_t>(camera.y * 256.0f),
+                   static_cast<int16_t>(camera.a / (2.0f * M_PI) * 1024.0f));
+    }
 
-        const auto trace = _rc->Trace(x);
-        auto screenY = trace.screenY;
+    // sized for ARGB, indexed frames use the first quarter
+    _frame = camera.target.pixels;
+    _pitch = camera.target.pitch / sizeof(Pixel);
+    _target = _columnMajor.empty() ? _frame : _columnMajor.data();
+    _visible.clear();
+}
+
+int Renderer::Tasks(Pass pass) const
+{
+    switch (pass) {
+    case PASS_COLUMNS:
+        return (_columns + BAND_WIDTH - 1) / BAND_WIDTH;
+    case PASS_TRANSPOSE:
+        return _columnMajor.empty() ? 0 : SCREEN_HEIGHT / TRANSPOSE_BLOCK;
+    case PASS_ROWS:
+        return _texturedFloor ? SCREEN_HEIGHT / ROW_BAND : 0;
+    case PASS_CULL:
+        return _sprites != nullptr ? 1 : 0;
+    case PASS_SPRITES:
+        return _visible.empty() ? 0 : SCREEN_WIDTH / BAND_WIDTH;
+    default:
+        return 0;
+    }
+}
 
-        int16_t ws = HORIZON_HEIGHT - trace.screenY;
+// the caster is read-only after Start, column tasks only write their own
+// columns and row tasks their own rows. The floor and ceiling go after the
+// walls, which leave their pixels untouched, and sprites last, in front of
+// the walls and floors they hide
+template <typename Pixel>
+void Renderer::RunTask(Pass pass, int task)
+{
+    Pixel *fb = static_cast<Pixel *>(_frame);
+    Pixel *target = static_cast<Pixel *>(_target);
+    switch (pass) {
+    case PASS_COLUMNS: {
+        const uint16_t first = task * BAND_WIDTH;
+        const uint16_t count = std::min<int>(BAND_WIDTH, _columns - first);
+        if (_columnMajor.empty()) {
+            RenderColumns<Pixel, false>(first, count, target);
+        } else {
+            RenderColumns<Pixel, true>(first, count, target);
+        }
+        break;
+    }
+    case PASS_TRANSPOSE: {
+        PROFILE_SCOPE(PROFILE_TRANSPOSE);
+        TransposeRows(target, fb, _pitch, task * TRANSPOSE_BLOCK);
+        break;
+    }
+    case PASS_ROWS: {
+        PROFILE_SCOPE(PROFILE_ROWS);
+        RenderRows(task * ROW_BAND, ROW_BAND, fb);
+        break;
+    }
+    case PASS_CULL: {
+        PROFILE_SCOPE(PROFILE_SPRITES);
+        CullSprites();
+        break;
+    }
+    case PASS_SPRITES: {
+        PROFILE_SCOPE(PROFILE_SPRITES);
+        RenderSprites(task * BAND_WIDTH, (task + 1) * BAND_WIDTH, fb);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// first and count are traced columns; at reduced resolution each one covers
+// several screen columns. fb is column-major when ColumnMajor
+template <typename Pixel, bool ColumnMajor>
+void Renderer::RenderColumns(uint16_t first, uint16_t count, Pixel *fb)
+{
+    // from one pixel of a column to the next, and from column to column
+    const size_t pixelStep = ColumnMajor ? 1 : _pitch;
+    constexpr int columnStep = ColumnMajor ? SCREEN_HEIGHT : 1;
+
+    {
+        PROFILE_SCOPE(PROFILE_TRACE);
+        _rc->TraceColumns(first, count, &_trace);
+        PROFILE_COUNT(PROFILE_COLUMNS, count);
+    }
+
+    PROFILE_SCOPE(PROFILE_FILL);
+    for (int c = first; c < first + count; c++) {
+        const int x = c * SCREEN_WIDTH / _columns;
+        const int width = (c + 1) * SCREEN_WIDTH / _columns - x;
+        Pixel *lb = fb + x * columnStep;
+
+        auto screenY = _trace.screenY[c];
+
+        int16_t ws = HORIZON_HEIGHT - _trace.screenY[c];
         if (ws < 0) {
             ws = 0;
             screenY = HORIZON_HEIGHT;
         }
-        uint16_t to = trace.textureY;
+        uint16_t to = _trace.textureY[c];
+        const uint16_t ts = _trace.textureStep[c];
+        // side lighting and fog for the whole column
+        const Pixel *shade = _shading->Table<Pixel>(
+            g_materialRamp[_trace.material[c] % MATERIAL_COUNT],
+            _trace.textureNo[c] == 1, screenY);
+        const Pixel *gradient = _shading->Gradient<Pixel>();
+        std::fill(_wallHeight + x, _wallHeight + x + width, screenY);
+        std::fill(_depth + x, _depth + x + width, _trace.distance[c]);
 
         // sky
-        for (int y = 0; y < ws; y++) {
-            *lb = GetARGB(96 + (HORIZON_HEIGHT - y));
-            lb += SCREEN_WIDTH;
+        if (_texturedFloor) {
+            lb += ws * pixelStep;
+        } else {
+            PROFILE_COUNT(PROFILE_SKY_PIXELS, ws);
+            for (int y = 0; y < ws; y++) {
+                *lb = gradient[y];
+                lb += pixelStep;
+            }
         }
 
-        const auto tx = static_cast<int>(trace.textureX >> 2);
+        // distant walls read a mip, every texel of it lands on screen
+        const uint8_t level = TextureAtlas::Level(ts);
+        const uint8_t *texture = _atlas->Column(
+            _trace.material[c], _trace.textureX[c] >> 2, level);
+        PROFILE_COUNT(PROFILE_WALL_PIXELS, screenY * 2);
         for (int y = 0; y < screenY * 2; y++) {
             // paint texture pixel
-            auto ty = static_cast<int>(to >> 10);
-            auto tv = g_texture8[(ty << 6) + tx];
+            *lb = shade[texture[to >> (10 + level)]];
+            to += ts;
+            lb += pixelStep;
+        }
+
+        if (!_texturedFloor) {
+            PROFILE_COUNT(PROFILE_FLOOR_PIXELS,
+                          SCREEN_HEIGHT - HORIZON_HEIGHT - screenY);
+            for (int y = HORIZON_HEIGHT + screenY; y < SCREEN_HEIGHT; y++) {
+                *lb = gradient[y];
+                lb += pixelStep;
+            }
+        }
+
+        if (width > 1) {
+            WidenColumn<Pixel, ColumnMajor>(fb + x * columnStep, width,
+                                            pixelStep);
+        }
+    }
+}
+
+// rows first to first + count of the floor and ceiling, in spans between
+// the walls of the column pass. Row y sees the floor (or ceiling) where it
+// projects from, at the same distance in every column
+template <typename Pixel>
+void Renderer::RenderRows(int first, int count, Pixel *fb)
+{
+    const float sinA = sinf(_playerA);
+    const float cosA = cosf(_playerA);
+    for (int y = first; y < first + count; y++) {
+        const bool floor = y >= HORIZON_HEIGHT;
+        // columns whose wall is at most this high leave row y open
+        const int height = floor ? y - HORIZON_HEIGHT : HORIZON_HEIGHT - 1 - y;
 
-            to += trace.textureStep;
+        // walls are 1 tile high and seen from half way up, so INV_FACTOR
+        // rows from the horizon stand for half a tile at distance 1
+        const float distance = INV_FACTOR / (height + 0.5f);
+        // the column angles follow atan(x / (SCREEN_WIDTH / 2) * PI / 4)
+        const float lateral = distance * (M_PI / 4) / (SCREEN_WIDTH / 2);
+        const float rowX = _playerX + distance * sinA -
+                           lateral * (SCREEN_WIDTH / 2) * cosA;
+        const float rowY = _playerY + distance * cosA +
+                           lateral * (SCREEN_WIDTH / 2) * sinA;
+        const uint32_t u = static_cast<int32_t>(rowX * 65536.0f);
+        const uint32_t v = static_cast<int32_t>(rowY * 65536.0f);
+        const uint32_t du = static_cast<int32_t>(lateral * cosA * 65536.0f);
+        const uint32_t dv = static_cast<int32_t>(-lateral * sinA * 65536.0f);
+        const Pixel *shade = _shading->Table<Pixel>(
+            floor ? RAMP_FLOOR : RAMP_CEILING, false, height);
 
-            if (trace.textureNo == 1) {
-                // dark wall
-                tv >>= 1;
+        Pixel *row = fb + y * _pitch;
+        int x = 0;
+        while (x < SCREEN_WIDTH) {
+            while (x < SCREEN_WIDTH && _wallHeight[x] > height) {
+                x++;
+            }
+            const int start = x;
+            while (x < SCREEN_WIDTH && _wallHeight[x] <= height) {
+                x++;
+            }
+            if (x > start) {
+                FillSpan(row, start, x, u, v, du, dv, g_texture8, shade);
             }
-            *lb = GetARGB(tv);
-            lb += SCREEN_WIDTH;
         }
+    }
+}
 
-        for (int y = 0; y < ws; y++) {
-            *lb = GetARGB(96 + (HORIZON_HEIGHT - (ws - y)));
-            lb += SCREEN_WIDTH;
+// collects the sprites in front of the walls into _visible. Only the grid
+// cells inside the view out to the farthest wall are looked at, and a
+// sprite only needs the wall depth of the bands it spans to be culled
+void Renderer::CullSprites()
+{
+    uint16_t farthest = 0;
+    for (int b = 0; b < SCREEN_WIDTH / BAND_WIDTH; b++) {
+        _bandDepth[b] = *std::max_element(_depth + b * BAND_WIDTH,
+                                          _depth + (b + 1) * BAND_WIDTH);
+        farthest = std::max(farthest, _bandDepth[b]);
+    }
+
+    // columns spread over +-edge tiles to the side per tile of depth, as in
+    // RenderRows
+    const float edge = M_PI / 4;
+    const float sinA = sinf(_playerA);
+    const float cosA = cosf(_playerA);
+    const float far = farthest / 256.0f;
+    const float leftX = _playerX + far * (sinA - edge * cosA);
+    const float leftY = _playerY + far * (cosA + edge * sinA);
+    const float rightX = _playerX + far * (sinA + edge * cosA);
+    const float rightY = _playerY + far * (cosA - edge * sinA);
+    const float pad = _sprites->MaxSize() / 2;
+
+    _sprites->Query(
+        std::min({_playerX, leftX, rightX}) - pad,
+        std::min({_playerY, leftY, rightY}) - pad,
+        std::max({_playerX, leftX, rightX}) + pad,
+        std::max({_playerY, leftY, rightY}) + pad, [&](uint32_t id) {
+            const Sprite &s = _sprites->Get(id);
+            const float dx = s.x - _playerX;
+            const float dy = s.y - _playerY;
+            const float depth = dx * sinA + dy * cosA;
+            if (depth < SPRITE_NEAR || depth * 256.0f >= farthest) {
+                return;
+            }
+            const float columns = (SCREEN_WIDTH / 2) / edge / depth;
+            const float left = SCREEN_WIDTH / 2 +
+                               (dx * cosA - dy * sinA - s.size / 2) * columns;
+            // the columns whose centre it covers
+            const int first = std::max<int>(ceilf(left - 0.5f), 0);
+            const int end = std::min<int>(
+                ceilf(left + s.size * columns - 0.5f), SCREEN_WIDTH);
+            if (first >= end) {
+                return;
+            }
+            const uint16_t d = depth * 256.0f;
+            bool seen = false;
+            for (int b = first / BAND_WIDTH; b <= (end - 1) / BAND_WIDTH;
+                 b++) {
+                seen |= _bandDepth[b] > d;
+            }
+            if (!seen) {
+                return;
+            }
+            // standing on the floor where a wall at its depth would
+            const float rows = 2 * INV_FACTOR / depth;
+            const float foot = HORIZON_HEIGHT + rows / 2;
+            const float top = foot - s.size * rows;
+            const int y0 = std::max<int>(ceilf(top - 0.5f), 0);
+            const int y1 = std::min<int>(ceilf(foot - 0.5f), SCREEN_HEIGHT);
+            _visible.push_back({d, static_cast<int16_t>(first),
+                                static_cast<int16_t>(end),
+                                static_cast<int16_t>(y0),
+                                static_cast<int16_t>(y1), left, top, columns,
+                                rows, id});
+        });
+
+    std::sort(_visible.begin(), _visible.end(),
+              [](const VisibleSprite &a, const VisibleSprite &b) {
+                  return a.depth < b.depth ||
+                         (a.depth == b.depth && a.id < b.id);
+              });
+    if (!_visible.empty() && _covered.empty()) {
+        _covered.resize(SCREEN_WIDTH * SCREEN_HEIGHT);
+    }
+}
+
+// columns first to end of the visible sprites, nearest first so each pixel
+// is drawn once, and only where the sprite is in front of the wall
+template <typename Pixel>
+void Renderer::RenderSprites(int first, int end, Pixel *fb)
+{
+    for (const auto &v : _visible) {
+        const int x0 = std::max<int>(v.first, first);
+        const int x1 = std::min<int>(v.end, end);
+        if (x0 >= x1) {
+            continue;
+        }
+        const Sprite &s = _sprites->Get(v.id);
+        const int y0 = v.y0;
+        const int y1 = v.y1;
+        // 16.16 texels per row, from the first row drawn
+        const float texelsPerRow = TEXTURE_SIZE / (s.size * v.rows);
+        const uint32_t ts = texelsPerRow * 65536.0f;
+        const uint32_t to = (y0 + 0.5f - v.top) * texelsPerRow * 65536.0f;
+        const float texelsPerColumn = TEXTURE_SIZE / (s.size * v.columns);
+        const Pixel *shade = _shading->Table<Pixel>(
+            s.ramp, false, std::min<float>(v.rows / 2, HORIZON_HEIGHT));
+
+        for (int x = x0; x < x1; x++) {
+            if (_depth[x] <= v.depth) {
+                continue;
+            }
+            const int tx = std::min<int>((x + 0.5f - v.left) * texelsPerColumn,
+                                         TEXTURE_SIZE - 1);
+            const uint8_t *texture = _atlas->Column(s.texture, tx, 0);
+            uint32_t t = to;
+            for (int y = y0; y < y1; y++) {
+                const int i = y * SCREEN_WIDTH + x;
+                const uint8_t texel =
+                    texture[std::min<uint32_t>(t >> 16, TEXTURE_SIZE - 1)];
+                t += ts;
+                if (texel != SPRITE_CLEAR && !_covered[i]) {
+                    fb[y * _pitch + x] = shade[texel];
+                    _covered[i] = 1;
+                }
+            }
+        }
+    }
+
+    // only this band's columns of the rows the sprites cover were set
+    for (const auto &v : _visible) {
+        const int x0 = std::max<int>(v.first, first);
+        const int x1 = std::min<int>(v.end, end);
+        for (int y = v.y0; y < v.y1 && x0 < x1; y++) {
+            std::fill_n(&_covered[y * SCREEN_WIDTH + x0], x1 - x0, 0);
+        }
+    }
+}
+
+template <typename Pixel, bool ColumnMajor>
+void Renderer::WidenColumn(Pixel *column, int width, size_t pitch)
+{
+    if (ColumnMajor) {
+        for (int i = 1; i < width; i++) {
+            std::copy(column, column + SCREEN_HEIGHT,
+                      column + i * SCREEN_HEIGHT);
         }
+        return;
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        std::fill(column + 1, column + width, column[0]);
+        column += pitch;
     }
 }
@@ -1,19 +1,182 @@
 #pragma once
 
+#include <stddef.h>
+#include <vector>
 #include "game.h"
 #include "raycaster.h"
+#include "resolution_governor.h"
+#include "shading.h"
+#include "sprite_grid.h"
+#include "texture_atlas.h"
+#include "thread_pool.h"
+
+// columns traced and filled per thread pool task
+#define BAND_WIDTH 16
+// sprites closer than this, in tiles, are not drawn
+#define SPRITE_NEAR 0.25f
+
+class Renderer;
+
+// where a SCREEN_WIDTH x SCREEN_HEIGHT frame is traced to: a buffer of its
+// own, a part of a larger frame or locked SDL texture memory
+template <typename Pixel>
+struct RenderTarget {
+    Pixel *pixels;
+    // bytes from one row to the next, a multiple of the pixel size.
+    // Row-major columns are filled a row apart, wide pitches spread them
+    // over more cache sets than SetColumnMajor frames do
+    size_t pitch = SCREEN_WIDTH * sizeof(Pixel);
+};
+
+// a view traced by Renderer::TraceFrames: the renderer tracing it, where it
+// stands and looks, as Game's player, and where its frame goes
+template <typename Pixel>
+struct Camera {
+    Renderer *renderer;
+    float x;
+    float y;
+    float a;
+    RenderTarget<Pixel> target;
+};
 
 class Renderer
 {
     RayCaster *_rc;
+    ThreadPool *_pool;
+    ResolutionGovernor *_governor = nullptr;
+    const TextureAtlas *_atlas = &TextureAtlas::Default();
+    const Shading *_shading = &Shading::Default();
+    const SpriteGrid *_sprites = nullptr;
+    uint16_t _columns = SCREEN_WIDTH;
+    RayCaster::TraceBatch _trace;
+    // column-major frame, empty unless SetColumnMajor
+    std::vector<uint32_t> _columnMajor;
+    bool _texturedFloor = false;
+    // per screen column, rows the wall covers above and below the horizon
+    uint8_t _wallHeight[SCREEN_WIDTH];
+    // per screen column, the wall distance as in TraceResult; and its
+    // maximum per band of BAND_WIDTH columns
+    uint16_t _depth[SCREEN_WIDTH];
+    uint16_t _bandDepth[SCREEN_WIDTH / BAND_WIDTH];
+    // sprites in front of some wall this frame, nearest first
+    struct VisibleSprite {
+        uint16_t depth;
+        int16_t first;
+        int16_t end;
+        // rows y0 to y1 it covers
+        int16_t y0;
+        int16_t y1;
+        // screen column of its left edge, screen row of its top, columns and
+        // rows per tile
+        float left;
+        float top;
+        float columns;
+        float rows;
+        uint32_t id;
+    };
+    std::vector<VisibleSprite> _visible;
+    // pixels a nearer sprite already drew; each band clears what its
+    // sprites set once they are drawn, so it is all clear between frames
+    std::vector<uint8_t> _covered;
+    float _playerX;
+    float _playerY;
+    float _playerA;
+    // the frame being traced, pixels per row of it, and where the columns
+    // are filled: the frame or the column-major buffer
+    void *_frame;
+    size_t _pitch = SCREEN_WIDTH;
+    void *_target;
+    // this renderer's tasks of the current pass of a batch
+    int _batchFirst;
+    int _batchEnd;
 
-    inline static uint32_t GetARGB(uint8_t brightness)
-    {
-        return (brightness << 16) + (brightness << 8) + brightness;
-    }
+    // the passes of a frame, each one waits for the one before
+    enum Pass {
+        PASS_COLUMNS,
+        PASS_TRANSPOSE,
+        PASS_ROWS,
+        PASS_CULL,
+        PASS_SPRITES,
+        PASS_COUNT
+    };
+
+    // Pixel is uint32_t for ARGB frames, uint8_t for indexed ones
+    template <typename Pixel>
+    static void RenderBatch(Game *g,
+                            const Camera<Pixel> *cameras,
+                            size_t count,
+                            ThreadPool *pool);
+    template <typename Pixel>
+    void Begin(Game *g, const Camera<Pixel> &camera);
+    int Tasks(Pass pass) const;
+    template <typename Pixel>
+    void RunTask(Pass pass, int task);
+    template <typename Pixel, bool ColumnMajor>
+    void RenderColumns(uint16_t first, uint16_t count, Pixel *fb);
+    template <typename Pixel, bool ColumnMajor>
+    static void WidenColumn(Pixel *column, int width, size_t pitch);
+    template <typename Pixel>
+    void RenderRows(int first, int count, Pixel *fb);
+    void CullSprites();
+    template <typename Pixel>
+    void RenderSprites(int first, int end, Pixel *fb);
 
 public:
     void TraceFrame(Game *g, uint32_t *frameBuffer);
-    Renderer(RayCaster *rc) { _rc = rc; };
+    void TraceFrame(Game *g, const RenderTarget<uint32_t> &target);
+    // a byte per pixel, indices into Palette()
+    void TraceFrame(Game *g, uint8_t *frameBuffer);
+    void TraceFrame(Game *g, const RenderTarget<uint8_t> &target);
+    // count cameras onto the world of g in one go, their passes spread over
+    // pool together so the work scales with the pixels traced, not with the
+    // cameras. Each camera needs a renderer and caster of its own, see
+    // RayCaster::Clone; their governors are fed the time of the batch
+    static void TraceFrames(Game *g,
+                            const Camera<uint32_t> *cameras,
+                            size_t count,
+                            ThreadPool *pool);
+    static void TraceFrames(Game *g,
+                            const Camera<uint8_t> *cameras,
+                            size_t count,
+                            ThreadPool *pool);
+    // the 256 ARGB colours of indexed frames
+    static const uint32_t *Palette();
+    // indexed pixels to ARGB, for presenting
+    static void ExpandIndexed(const uint8_t *indexed,
+                              uint32_t *frameBuffer,
+                              size_t count);
+    // a SCREEN_WIDTH x SCREEN_HEIGHT indexed frame into target
+    static void ExpandIndexed(const RenderTarget<uint8_t> &indexed,
+                              const RenderTarget<uint32_t> &target);
+    // trace the number of columns the governor picks and feed it the frame
+    // time; null traces every column
+    void SetGovernor(ResolutionGovernor *governor) { _governor = governor; }
+    // fill columns into a column-major buffer, each one contiguous, and
+    // transpose it into the frame buffer at the end of the frame
+    void SetColumnMajor(bool columnMajor);
+    // wall textures by material, TextureAtlas::Default() unless set
+    void SetAtlas(const TextureAtlas *atlas) { _atlas = atlas; }
+    // lighting and fog tables, Shading::Default() unless set
+    void SetShading(const Shading *shading) { _shading = shading; }
+    // billboards drawn over the walls, their textures taken from the atlas;
+    // null draws none
+    void SetSprites(const SpriteGrid *sprites) { _sprites = sprites; }
+    // sprites drawn in the last frame
+    size_t VisibleSprites() const { return _visible.size(); }
+    // the wall distance per screen column of the last frame, as in
+    // TraceResult
+    const uint16_t *Depth() const { return _depth; }
+    // cast textured floors and ceilings row by row around the walls instead
+    // of the flat gradients
+    void SetTexturedFloor(bool texturedFloor)
+    {
+        _texturedFloor = texturedFloor;
+    }
+    // bands of BAND_WIDTH columns are spread over pool when it is not null
+    Renderer(RayCaster *rc, ThreadPool *pool = nullptr)
+    {
+        _rc = rc;
+        _pool = pool;
+    };
     ~Renderer(){};
 };
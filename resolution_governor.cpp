@@ -0,0 +1,47 @@
+#include "resolution_governor.h"
+#include <algorithm>
+
+// aim this far below the budget so frame time noise does not miss it
+#define GOVERNOR_HEADROOM 0.9f
+
+void ResolutionGovernor::Update(float seconds)
+{
+    // only this thread writes, plain stores are enough for the readers
+    const bool miss = seconds > _budget;
+    const uint64_t frames = Frames() + 1;
+    _frames.store(frames, std::memory_order_relaxed);
+    _misses.store(Misses() + miss, std::memory_order_relaxed);
+    _missRate.store(MissRate() + ((miss ? 1.0f : 0.0f) - MissRate()) * 0.05f,
+                    std::memory_order_relaxed);
+
+    const uint16_t current = Columns();
+    const float cost = seconds / current;
+    if (frames == 1) {
+        _costPerColumn = cost;
+    } else {
+        _costPerColumn += (cost - _costPerColumn) * 0.1f;
+    }
+    if (_costPerColumn <= 0) {
+        return;
+    }
+
+    const float target = _budget * GOVERNOR_HEADROOM / _costPerColumn;
+    int columns = std::min<float>(target, SCREEN_WIDTH);
+    columns -= columns % GOVERNOR_STEP;
+    columns = std::max<int>(columns, _minColumns);
+
+    // drop at once, recover one step per frame
+    if (columns < current) {
+        _columns.store(columns, std::memory_order_relaxed);
+    } else if (columns > current) {
+        _columns.store(std::min<int>(current + GOVERNOR_STEP, SCREEN_WIDTH),
+                       std::memory_order_relaxed);
+    }
+}
+
+ResolutionGovernor::ResolutionGovernor(float budget, uint16_t minColumns)
+    : _budget(budget),
+      _minColumns(std::max<uint16_t>(std::min(minColumns, SCREEN_WIDTH), 1)),
+      _columns(SCREEN_WIDTH)
+{
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "raycaster.h"
+
+// traced columns move in steps of this many
+#define GOVERNOR_STEP 8
+
+// chooses how many columns Renderer::TraceFrame traces so that the frame
+// time stays within a budget; the renderer widens them to SCREEN_WIDTH
+class ResolutionGovernor
+{
+public:
+    // the state is updated by the thread tracing and may be read from
+    // others, as a pipelined front end does
+    uint16_t Columns() const
+    {
+        return _columns.load(std::memory_order_relaxed);
+    }
+    // traced columns over output columns
+    float Scale() const { return Columns() / static_cast<float>(SCREEN_WIDTH); }
+    // share of recent frames over budget, exponentially weighted
+    float MissRate() const { return _missRate.load(std::memory_order_relaxed); }
+    uint64_t Frames() const { return _frames.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return _misses.load(std::memory_order_relaxed); }
+    float Budget() const { return _budget; }
+
+    // feed the measured time of the frame traced at Columns()
+    void Update(float seconds);
+
+    // budget in seconds
+    explicit ResolutionGovernor(float budget,
+                                uint16_t minColumns = SCREEN_WIDTH / 4);
+    ~ResolutionGovernor(){};
+
+private:
+    float _budget;
+    uint16_t _minColumns;
+    std::atomic<uint16_t> _columns;
+    float _costPerColumn = 0;
+    std::atomic<float> _missRate{0};
+    std::atomic<uint64_t> _frames{0};
+    std::atomic<uint64_t> _misses{0};
+};
@@ -0,0 +1,119 @@
+#include "shading.h"
+#include <algorithm>
+#include <array>
+
+// per ramp channel shifts for red, green and blue
+static const uint8_t g_rampTint[PALETTE_RAMPS][3] = {
+    {0, 0, 0},  // RAMP_GREY
+    {1, 1, 0},  // RAMP_BORDER
+    {0, 1, 2},  // RAMP_PILLAR
+    {1, 2, 2},  // RAMP_FLOOR
+    {2, 2, 1},  // RAMP_CEILING
+    {0, 0, 1},  // RAMP_DOOR
+};
+
+static inline uint32_t ShadeARGB(uint8_t brightness, uint8_t ramp)
+{
+    const uint8_t *tint = g_rampTint[ramp];
+    return ((brightness >> tint[0]) << 16) + ((brightness >> tint[1]) << 8) +
+           (brightness >> tint[2]);
+}
+
+// 32 levels per ramp
+static inline uint8_t ShadeIndexed(uint8_t brightness, uint8_t ramp)
+{
+    return ramp << PALETTE_RAMP_SHIFT | brightness >> 3;
+}
+
+// a towards b by weight / 256
+static inline uint8_t Mix(uint8_t a, uint8_t b, int weight)
+{
+    return (a * (256 - weight) + b * weight + 128) >> 8;
+}
+
+static const auto g_palette = []() {
+    std::array<uint32_t, 256> palette;
+    for (int i = 0; i < 256; i++) {
+        const uint8_t level = i & 31;
+        palette[i] =
+            ShadeARGB(level << 3 | level >> 2, i >> PALETTE_RAMP_SHIFT);
+    }
+    return palette;
+}();
+
+const uint32_t *Shading::Palette()
+{
+    return g_palette.data();
+}
+
+void Shading::SetFog(uint32_t colour, float distance)
+{
+    _fogColour = colour;
+    _fogDistance = distance;
+    Build();
+}
+
+void Shading::Build()
+{
+    for (int height = 0; height <= HORIZON_HEIGHT; height++) {
+        // as the casters project walls, INV_FACTOR / distance rows high
+        const float distance = INV_FACTOR / (height + 0.5f);
+        _distance[height] = 0;
+        if (_fogDistance > 0) {
+            _distance[height] = std::min<int>(
+                distance / _fogDistance * (SHADE_DISTANCES - 1) + 0.5f,
+                SHADE_DISTANCES - 1);
+        }
+    }
+
+    const uint8_t fog[3] = {static_cast<uint8_t>(_fogColour >> 16),
+                            static_cast<uint8_t>(_fogColour >> 8),
+                            static_cast<uint8_t>(_fogColour)};
+    const uint8_t fogBrightness =
+        (fog[0] * 77 + fog[1] * 150 + fog[2] * 29) >> 8;
+    uint32_t *argb = _argb.data();
+    uint8_t *indexed = _indexed.data();
+    for (int ramp = 0; ramp < PALETTE_RAMPS; ramp++) {
+        for (int dark = 0; dark < 2; dark++) {
+            for (int step = 0; step < SHADE_DISTANCES; step++) {
+                const int weight = step * 256 / (SHADE_DISTANCES - 1);
+                for (int texel = 0; texel < 256; texel++) {
+                    const uint8_t brightness = dark ? texel >> 1 : texel;
+                    const uint32_t c = ShadeARGB(brightness, ramp);
+                    *argb++ = Mix(c >> 16, fog[0], weight) << 16 |
+                              Mix(c >> 8, fog[1], weight) << 8 |
+                              Mix(c, fog[2], weight);
+                    *indexed++ = ShadeIndexed(
+                        Mix(brightness, fogBrightness, weight), ramp);
+                }
+            }
+        }
+    }
+
+    // rows of sky above the horizon, floor below, brightening away from it
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const bool floor = y >= HORIZON_HEIGHT;
+        const uint8_t height =
+            floor ? y - HORIZON_HEIGHT : HORIZON_HEIGHT - 1 - y;
+        const uint8_t texel = floor ? 96 + y - HORIZON_HEIGHT
+                                    : 96 + HORIZON_HEIGHT - y;
+        *argb++ = Table<uint32_t>(RAMP_GREY, false, height)[texel];
+        *indexed++ = Table<uint8_t>(RAMP_GREY, false, height)[texel];
+    }
+}
+
+const Shading &Shading::Default()
+{
+    static const Shading shading;
+    return shading;
+}
+
+Shading::Shading()
+    : _gradientOffset(PALETTE_RAMPS * 2 * SHADE_DISTANCES * 256),
+      _argb(_gradientOffset + SCREEN_HEIGHT),
+      _indexed(_gradientOffset + SCREEN_HEIGHT)
+{
+    Build();
+}
+
+Shading::~Shading() {}
@@ -0,0 +1,82 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+#include "raycaster.h"
+
+// colour ramps of 32 levels in the palette of indexed frames, the high
+// PALETTE_RAMP_SHIFT bits of a palette index
+#define PALETTE_RAMPS 8
+#define PALETTE_RAMP_SHIFT 5
+#define RAMP_GREY 0
+#define RAMP_BORDER 1
+#define RAMP_PILLAR 2
+#define RAMP_FLOOR 3
+#define RAMP_CEILING 4
+#define RAMP_DOOR 5
+
+// fog steps between the eye and the fog distance
+#define SHADE_DISTANCES 16
+// the fog of the -d options
+#define FOG_COLOUR 0x303848
+
+// brightness tables with the lighting and fog baked in. Each maps the 256
+// values of a texel to the pixel drawn for it on one ramp, one wall side
+// and one distance, so fill loops pick a table per column (or row) and do
+// nothing but look pixels up
+class Shading
+{
+public:
+    // the table for texels on ramp, of the dark wall side or not, at height
+    // rows from the horizon: the half height of a wall or the distance of a
+    // floor or ceiling row, both at most HORIZON_HEIGHT
+    template <typename Pixel>
+    const Pixel *Table(uint8_t ramp, bool dark, uint8_t height) const
+    {
+        return Tables<Pixel>().data() +
+               ((ramp * 2 + dark) * SHADE_DISTANCES + _distance[height]) *
+                   256;
+    }
+
+    // the flat sky and floor gradient, a pixel per screen row
+    template <typename Pixel>
+    const Pixel *Gradient() const
+    {
+        return Tables<Pixel>().data() + _gradientOffset;
+    }
+
+    // fade everything to ARGB colour, completely at distance tiles; 0
+    // turns fog off. Indexed frames fade to the brightness of colour
+    void SetFog(uint32_t colour, float distance);
+
+    // the 256 ARGB colours of indexed frames
+    static const uint32_t *Palette();
+
+    // side lighting only, no fog
+    static const Shading &Default();
+
+    Shading();
+    ~Shading();
+
+private:
+    template <typename Pixel>
+    const std::vector<Pixel> &Tables() const
+    {
+        if constexpr (std::is_same<Pixel, uint32_t>::value) {
+            return _argb;
+        } else {
+            return _indexed;
+        }
+    }
+    void Build();
+
+    uint32_t _fogColour = 0;
+    float _fogDistance = 0;
+    // distance step by height from the horizon
+    uint8_t _distance[HORIZON_HEIGHT + 1];
+    // the tables, then the gradient
+    size_t _gradientOffset;
+    std::vector<uint32_t> _argb;
+    std::vector<uint8_t> _indexed;
+};
@@ -0,0 +1,92 @@
+#include "sprite_grid.h"
+#include "raycaster_map.h"
+#include "shading.h"
+
+uint32_t SpriteGrid::CellOf(const Sprite &sprite) const
+{
+    return Cell(sprite.y, _cellsY) * _cellsX + Cell(sprite.x, _cellsX);
+}
+
+uint32_t SpriteGrid::Add(const Sprite &sprite)
+{
+    const uint32_t id = _sprites.size();
+    const uint32_t cell = CellOf(sprite);
+    _sprites.push_back(sprite);
+    _cell.push_back(cell);
+    _slot.push_back(_cells[cell].size());
+    _cells[cell].push_back(id);
+    _maxSize = std::max(_maxSize, sprite.size);
+    return id;
+}
+
+void SpriteGrid::Move(uint32_t id, float x, float y)
+{
+    _sprites[id].x = x;
+    _sprites[id].y = y;
+    const uint32_t cell = CellOf(_sprites[id]);
+    if (cell == _cell[id]) {
+        return;
+    }
+    // the last sprite of the old cell takes this one's place
+    auto &from = _cells[_cell[id]];
+    from[_slot[id]] = from.back();
+    _slot[from.back()] = _slot[id];
+    from.pop_back();
+    _cell[id] = cell;
+    _slot[id] = _cells[cell].size();
+    _cells[cell].push_back(id);
+}
+
+SpriteGrid::SpriteGrid(uint32_t width, uint32_t height)
+    : _cellsX(((width - 1) >> SPRITE_CELL_SHIFT) + 1),
+      _cellsY(((height - 1) >> SPRITE_CELL_SHIFT) + 1),
+      _cells(_cellsX * _cellsY)
+{
+}
+
+void ScatterSprites(SpriteGrid *grid,
+                    uint32_t count,
+                    uint8_t texture,
+                    uint32_t seed)
+{
+    static const uint8_t ramps[3] = {RAMP_BORDER, RAMP_PILLAR, RAMP_FLOOR};
+    uint32_t state = seed * 2654435761u + 1;
+    const auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    while (count > 0) {
+        const uint32_t x = next() % MAP_X;
+        const uint32_t y = next() % MAP_Y;
+        if (g_tiles[TileIndex(x, y)] != 0) {
+            continue;
+        }
+        // anywhere in the middle half of the tile
+        const float sx = x + 0.25f + (next() % 64) / 128.0f;
+        const float sy = y + 0.25f + (next() % 64) / 128.0f;
+        const float size = 0.25f + (next() % 64) / 128.0f;
+        grid->Add({sx, sy, size, texture, ramps[next() % 3]});
+        count--;
+    }
+}
+
+void SpriteOrb(uint8_t *texels)
+{
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            const int dx = 2 * x - 63;
+            const int dy = 2 * y - 63;
+            const int r2 = dx * dx + dy * dy;
+            uint8_t texel = SPRITE_CLEAR;
+            if (r2 < 62 * 62) {
+                // lit from the top left, never SPRITE_CLEAR inside
+                const int light = 255 - (r2 + (dx + dy) * 40) / 24;
+                texel = std::min(std::max(light, 1), 255) *
+                            (128 + g_texture8[y * 64 + x] / 2) >>
+                        8;
+                texel = std::max<uint8_t>(texel, 1);
+            }
+            texels[y * 64 + x] = texel;
+        }
+    }
+}
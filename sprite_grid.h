@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+// sprites are bucketed in cells of 2^SPRITE_CELL_SHIFT tiles per side
+#define SPRITE_CELL_SHIFT 2
+// sprite texels of this value are see-through
+#define SPRITE_CLEAR 0
+
+// a billboard standing on the floor, always facing the camera
+struct Sprite {
+    // centre of the base, in tiles
+    float x;
+    float y;
+    // width and height in tiles
+    float size;
+    // TextureAtlas material the texture is stored as
+    uint8_t texture;
+    // Shading ramp it is drawn in
+    uint8_t ramp;
+};
+
+// sprites of a world, bucketed by cell so a view only looks at the cells
+// it can see into instead of at every sprite
+class SpriteGrid
+{
+public:
+    // ids are handed out in order from 0
+    uint32_t Add(const Sprite &sprite);
+    void Move(uint32_t id, float x, float y);
+    const Sprite &Get(uint32_t id) const { return _sprites[id]; }
+    size_t Size() const { return _sprites.size(); }
+    // the widest sprite, for padding queries
+    float MaxSize() const { return _maxSize; }
+
+    // visit(id) for the sprites of the cells touching [minX, maxX] x
+    // [minY, maxY], in tiles
+    template <typename Visit>
+    void Query(float minX,
+               float minY,
+               float maxX,
+               float maxY,
+               Visit visit) const
+    {
+        const int x0 = Cell(minX, _cellsX);
+        const int x1 = Cell(maxX, _cellsX);
+        const int y1 = Cell(maxY, _cellsY);
+        for (int y = Cell(minY, _cellsY); y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                for (auto id : _cells[y * _cellsX + x]) {
+                    visit(id);
+                }
+            }
+        }
+    }
+
+    // width and height in tiles
+    SpriteGrid(uint32_t width, uint32_t height);
+    ~SpriteGrid(){};
+
+private:
+    static int Cell(float tile, int cells)
+    {
+        return std::min(std::max(static_cast<int>(tile) >> SPRITE_CELL_SHIFT,
+                                 0),
+                        cells - 1);
+    }
+    uint32_t CellOf(const Sprite &sprite) const;
+
+    int _cellsX;
+    int _cellsY;
+    float _maxSize = 0;
+    std::vector<Sprite> _sprites;
+    // per sprite its cell and its place in the cell
+    std::vector<uint32_t> _cell;
+    std::vector<uint32_t> _slot;
+    std::vector<std::vector<uint32_t>> _cells;
+};
+
+// count sprites of texture on open tiles of g_map, the same ones per seed
+void ScatterSprites(SpriteGrid *grid,
+                    uint32_t count,
+                    uint8_t texture,
+                    uint32_t seed);
+
+// a 64 x 64 row-major orb from g_texture8, clear around it
+void SpriteOrb(uint8_t *texels);
@@ -0,0 +1,65 @@
+#include "texture_atlas.h"
+#include <string.h>
+#include "raycaster_data.h"
+
+// 64, 32, ..., 1 texels per side
+const uint16_t TextureAtlas::_levelOffset[TEXTURE_SIZES + 1] = {
+    0, 4096, 5120, 5376, 5440, 5456, 5460};
+
+// floor(log2(textureStep >> 10)), so walls are never sampled blurrier than
+// their size on screen
+static const uint8_t g_mipLevel[64] = {
+    0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
+
+uint8_t TextureAtlas::Level(uint16_t textureStep)
+{
+    return g_mipLevel[textureStep >> 10];
+}
+
+void TextureAtlas::SetTexture(uint8_t material, const uint8_t *texels)
+{
+    // materials sharing the default texture get a slot of their own
+    if (_slot[material] == 0 && material != 0) {
+        _slot[material] = _texels.size() / TEXTURE_MIP_TEXELS;
+        _texels.resize(_texels.size() + TEXTURE_MIP_TEXELS);
+    }
+    uint8_t *mips = &_texels[_slot[material] * TEXTURE_MIP_TEXELS];
+
+    for (int x = 0; x < TEXTURE_SIZE; x++) {
+        for (int y = 0; y < TEXTURE_SIZE; y++) {
+            mips[x * TEXTURE_SIZE + y] = texels[y * TEXTURE_SIZE + x];
+        }
+    }
+    // each level averages 2 x 2 texels of the one above
+    for (int level = 1; level <= TEXTURE_SIZES; level++) {
+        const uint8_t *src = mips + _levelOffset[level - 1];
+        uint8_t *dst = mips + _levelOffset[level];
+        const int size = TEXTURE_SIZE >> level;
+        for (int x = 0; x < size; x++) {
+            const uint8_t *left = src + 2 * x * 2 * size;
+            const uint8_t *right = left + 2 * size;
+            for (int y = 0; y < size; y++) {
+                dst[x * size + y] = (left[2 * y] + left[2 * y + 1] +
+                                     right[2 * y] + right[2 * y + 1] + 2) >>
+                                    2;
+            }
+        }
+    }
+}
+
+const TextureAtlas &TextureAtlas::Default()
+{
+    static const TextureAtlas atlas;
+    return atlas;
+}
+
+TextureAtlas::TextureAtlas() : _texels(TEXTURE_MIP_TEXELS)
+{
+    // slot 0 is shared until a material gets its own texture
+    memset(_slot, 0, sizeof(_slot));
+    SetTexture(0, g_texture8);
+}
+
+TextureAtlas::~TextureAtlas() {}
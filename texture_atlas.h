@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#define TEXTURE_SIZE 64
+#define TEXTURE_SIZES 6
+// texels of a texture and all its mips
+#define TEXTURE_MIP_TEXELS 5461
+
+// wall textures by material. Each is stored column-major, so a wall column
+// samples sequentially, with mips down to 1 x 1 for distant walls
+class TextureAtlas
+{
+public:
+    // the level whose texels are at least textureStep apart, textureStep
+    // in 1/1024 texels per pixel as in TraceResult
+    static uint8_t Level(uint16_t textureStep);
+
+    // texture column tx, in level 0 texels, of material at level; sample
+    // it with ty >> level
+    const uint8_t *Column(uint8_t material, uint8_t tx, uint8_t level) const
+    {
+        return &_texels[_slot[material] * TEXTURE_MIP_TEXELS +
+                        _levelOffset[level] +
+                        (tx >> level) * (TEXTURE_SIZE >> level)];
+    }
+
+    // TEXTURE_SIZE x TEXTURE_SIZE row-major texels for material; material 0
+    // sets the texture of all materials without one of their own
+    void SetTexture(uint8_t material, const uint8_t *texels);
+
+    // g_texture8 for every material
+    static const TextureAtlas &Default();
+
+    TextureAtlas();
+    ~TextureAtlas();
+
+private:
+    static const uint16_t _levelOffset[TEXTURE_SIZES + 1];
+
+    uint8_t _slot[256];
+    std::vector<uint8_t> _texels;
+};
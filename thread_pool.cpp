@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+
+void ThreadPool::Run(int count, const std::function<void(int)> &task)
+{
+    if (_workers.empty()) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    // _task and _pending are published before any task becomes visible
+    // through a queue lock
+    _task = &task;
+    _pending = count;
+
+    // contiguous ranges keep neighbouring columns on the same core
+    const unsigned n = Size();
+    for (unsigned q = 0; q < n; q++) {
+        std::lock_guard<std::mutex> lock(_queues[q]->lock);
+        for (int i = count * q / n; i < static_cast<int>(count * (q + 1) / n);
+             i++) {
+            _queues[q]->tasks.push_back(i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _generation++;
+    }
+    _wake.notify_all();
+
+    Work(0);
+
+    std::unique_lock<std::mutex> lock(_lock);
+    _done.wait(lock, [this] { return _pending == 0; });
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _wake.wait(lock,
+                       [&] { return _exiting || _generation != seen; });
+            if (_exiting) {
+                return;
+            }
+            seen = _generation;
+        }
+        Work(index);
+    }
+}
+
+void ThreadPool::Work(unsigned index)
+{
+    int task;
+    while (Pop(index, &task) || Steal(index, &task)) {
+        (*_task)(task);
+        if (_pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(_lock);
+            _done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::Pop(unsigned index, int *task)
+{
+    Queue &q = *_queues[index];
+    std::lock_guard<std::mutex> lock(q.lock);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    *task = q.tasks.front();
+    q.tasks.pop_front();
+    return true;
+}
+
+bool ThreadPool::Steal(unsigned index, int *task)
+{
+    const unsigned n = Size();
+    for (unsigned i = 1; i < n; i++) {
+        Queue &q = *_queues[(index + i) % n];
+        std::lock_guard<std::mutex> lock(q.lock);
+        if (!q.tasks.empty()) {
+            *task = q.tasks.back();
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        _queues.emplace_back(new Queue());
+    }
+    for (unsigned i = 1; i < threads; i++) {
+        _workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _exiting = true;
+    }
+    _wake.notify_all();
+    for (auto &w : _workers) {
+        w.join();
+    }
+}
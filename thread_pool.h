@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent workers with one task queue each; idle workers steal from the
+// back of the other queues
+class ThreadPool
+{
+public:
+    // run task(i) for every i in [0, count) and wait for all of them; the
+    // calling thread works on the first queue
+    void Run(int count, const std::function<void(int)> &task);
+
+    unsigned Size() const { return static_cast<unsigned>(_queues.size()); }
+
+    // threads includes the calling thread
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    void WorkerLoop(unsigned index);
+    void Work(unsigned index);
+    bool Pop(unsigned index, int *task);
+    bool Steal(unsigned index, int *task);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+    const std::function<void(int)> *_task = nullptr;
+    std::atomic<int> _pending{0};
+    std::mutex _lock;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    uint64_t _generation = 0;
+    bool _exiting = false;
+};
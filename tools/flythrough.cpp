@@ -0,0 +1,120 @@
+// renders a scripted camera path without a display and streams it as Y4M
+// or raw ARGB, to a file or to an encoder on standard output:
+//   flythrough -n 900 - | ffmpeg -i - flythrough.mp4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "camera_path.h"
+#include "game.h"
+#include "raycaster_fixed.h"
+#include "renderer.h"
+#include "thread_pool.h"
+#include "video_writer.h"
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-p path] [-n frames] [-r fps] [-j threads] [-f] "
+            "[-d tiles] [-a] out.y4m\n"
+            "  -p  spin, corridor, wall_hug or random (default corridor)\n"
+            "  -n  frames (default 600)\n"
+            "  -r  frames per second of the stream (default 30)\n"
+            "  -j  render threads, 1 renders on the calling thread\n"
+            "  -f  textured floor and ceiling\n"
+            "  -d  fade to fog over this many tiles\n"
+            "  -a  raw ARGB frames instead of Y4M\n"
+            "  out.y4m may be - for standard output\n",
+            name);
+}
+
+int main(int argc, char *args[])
+{
+    CameraPathType type = PATH_CORRIDOR;
+    int frames = 600;
+    int fps = 30;
+    unsigned threads = 1;
+    bool texturedFloor = false;
+    float fog = 0;
+    VideoFormat format = VIDEO_Y4M;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-p") && i + 1 < argc) {
+            type = PATH_COUNT;
+            for (int p = 0; p < PATH_COUNT; p++) {
+                const auto t = static_cast<CameraPathType>(p);
+                if (!strcmp(args[i + 1], CameraPathName(t))) {
+                    type = t;
+                }
+            }
+            i++;
+        } else if (!strcmp(args[i], "-n") && i + 1 < argc) {
+            frames = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-r") && i + 1 < argc) {
+            fps = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-j") && i + 1 < argc) {
+            threads = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-f")) {
+            texturedFloor = true;
+        } else if (!strcmp(args[i], "-d") && i + 1 < argc) {
+            fog = atof(args[++i]);
+        } else if (!strcmp(args[i], "-a")) {
+            format = VIDEO_RAW;
+        } else if (!path && (args[i][0] != '-' || !strcmp(args[i], "-"))) {
+            path = args[i];
+        } else {
+            Usage(args[0]);
+            return 1;
+        }
+    }
+    if (!path || type == PATH_COUNT || frames <= 0 || fps <= 0) {
+        Usage(args[0]);
+        return 1;
+    }
+
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool.reset(new ThreadPool(threads));
+    }
+    auto video = VideoWriter::Open(path, format, fps, pool.get());
+    if (!video) {
+        perror(path);
+        return 1;
+    }
+    Shading shading;
+    shading.SetFog(FOG_COLOUR, fog);
+    RayCasterFixed caster;
+    Renderer renderer(&caster, pool.get());
+    renderer.SetShading(&shading);
+    renderer.SetTexturedFloor(texturedFloor);
+
+    Game game;
+    std::vector<uint32_t> fb(SCREEN_WIDTH * SCREEN_HEIGHT);
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &pose : MakeCameraPath(type, frames)) {
+        game.playerX = pose.playerX;
+        game.playerY = pose.playerY;
+        game.playerA = pose.playerA;
+        game.doors.Update(game.playerX, game.playerY, 1.0f / fps);
+        renderer.TraceFrame(&game, fb.data());
+        if (!video->Write({fb.data()})) {
+            break;
+        }
+    }
+    const bool written = video->Flush();
+    const std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    fprintf(stderr, "%llu frames, %.1f MB in %.2f s: %.1f frames/s\n",
+            static_cast<unsigned long long>(video->Frames()),
+            video->Bytes() / 1e6, seconds.count(),
+            video->Frames() / seconds.count());
+    if (!written) {
+        perror(path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// bakes the hit table RayCasterBaked maps: every ray angle from every grid
+// cell over g_map, traced with CalculateDistance. Rays from the corners
+// of the grid cell are traced too, where they see another wall the entry is
+// left to the caster to trace. So are hits on doors, which move
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "raycaster_baked.h"
+#include "raycaster_fixed_kernels.h"
+
+template <uint8_t Quarter>
+static uint16_t BakeHit(uint16_t rayX, uint16_t rayY, uint8_t angle)
+{
+    int16_t deltaX;
+    int16_t deltaY;
+    uint8_t textureNo;
+    uint8_t textureX;
+    uint8_t material;
+    CalculateDistance<Quarter>(rayX, rayY, angle, &deltaX, &deltaY,
+                               &textureNo, &textureX, &material);
+    if (material == MATERIAL_DOOR) {
+        return BAKED_TRACE;
+    }
+    return HitTile<Quarter>(rayX, rayY, deltaX, deltaY, textureNo) |
+           textureNo << BAKED_TEXTURE_SHIFT |
+           material << BAKED_MATERIAL_SHIFT;
+}
+
+// the hit from the middle of the cell at (cellX, cellY), of 1 << size
+// units per side, or BAKED_TRACE if any corner disagrees
+template <uint8_t Quarter>
+static uint16_t BakeCell(uint16_t cellX,
+                         uint16_t cellY,
+                         uint8_t size,
+                         uint8_t angle)
+{
+    const uint16_t last = (1 << size) - 1;
+    const uint16_t middle = 1 << (size - 1);
+    const uint16_t hit =
+        BakeHit<Quarter>(cellX + middle, cellY + middle, angle);
+    if (BakeHit<Quarter>(cellX, cellY, angle) != hit ||
+        BakeHit<Quarter>(cellX + last, cellY, angle) != hit ||
+        BakeHit<Quarter>(cellX, cellY + last, angle) != hit ||
+        BakeHit<Quarter>(cellX + last, cellY + last, angle) != hit) {
+        return BAKED_TRACE;
+    }
+    return hit;
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-g grid_shift] hits.bin\n"
+            "  -g  2^grid_shift cells per tile side, 0 to 7 "
+            "(default 2)\n",
+            name);
+}
+
+int main(int argc, char *args[])
+{
+    int gridShift = 2;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-g") && i + 1 < argc) {
+            gridShift = atoi(args[++i]);
+        } else if (!path && args[i][0] != '-') {
+            path = args[i];
+        } else {
+            Usage(args[0]);
+            return 1;
+        }
+    }
+    if (!path || gridShift < 0 || gridShift > 7) {
+        Usage(args[0]);
+        return 1;
+    }
+
+    BakedHeader header = {};
+    header.magic = BAKED_MAGIC;
+    header.version = BAKED_VERSION;
+    header.gridShift = gridShift;
+    header.mapX = MAP_X;
+    header.mapY = MAP_Y;
+    header.mapHash = BakedMapHash();
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    if (fwrite(&header, sizeof(header), 1, f) != 1) {
+        perror(path);
+        fclose(f);
+        return 1;
+    }
+
+    // one row of grid cells at a time
+    const int side = 1 << gridShift;
+    const uint8_t size = 8 - gridShift;
+    std::vector<uint16_t> hits(MAP_X * side * BAKED_ANGLES);
+    for (int y = 0; y < MAP_Y * side; y++) {
+        for (int x = 0; x < MAP_X * side; x++) {
+            uint16_t *cell = &hits[x * BAKED_ANGLES];
+            for (int a = 0; a < BAKED_ANGLES; a++) {
+                switch (a >> 8) {
+                case 0:
+                    cell[a] = BakeCell<0>(x << size, y << size, size,
+                                              a % 256);
+                    break;
+                case 1:
+                    cell[a] = BakeCell<1>(x << size, y << size, size,
+                                              a % 256);
+                    break;
+                case 2:
+                    cell[a] = BakeCell<2>(x << size, y << size, size,
+                                              a % 256);
+                    break;
+                default:
+                    cell[a] = BakeCell<3>(x << size, y << size, size,
+                                              a % 256);
+                    break;
+                }
+            }
+        }
+        if (fwrite(hits.data(), sizeof(uint16_t), hits.size(), f) !=
+            hits.size()) {
+            perror(path);
+            fclose(f);
+            return 1;
+        }
+    }
+    if (fclose(f)) {
+        perror(path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+// load for the render server: clients each send their requests of random
+// poses one after another and check what comes back
+//   render_client -c 4 -n 200 -b 8 /tmp/raycaster.sock
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "camera_path.h"
+#include "render_server.h"
+
+struct ClientStats {
+    bool failed = false;
+    uint64_t bytes = 0;
+    // round trips, in seconds
+    std::vector<double> latency;
+    uint64_t queued = 0;
+};
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n requests] [-b poses] [-t] [-c clients] socket\n"
+            "  -n  requests per client (default 100)\n"
+            "  -b  poses per request (default 4)\n"
+            "  -t  column traces instead of frames\n"
+            "  -c  clients at once (default 1)\n",
+            name);
+}
+
+static bool ReadAll(int fd, void *data, size_t size)
+{
+    auto *bytes = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t n = read(fd, bytes, size);
+        if (n == 0 || (n < 0 && errno != EINTR)) {
+            return false;
+        }
+        if (n > 0) {
+            bytes += n;
+            size -= n;
+        }
+    }
+    return true;
+}
+
+static bool WriteAll(int fd, const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (n < 0 && errno != EINTR) {
+            return false;
+        }
+        if (n > 0) {
+            bytes += n;
+            size -= n;
+        }
+    }
+    return true;
+}
+
+static void Client(const char *path,
+                   int requests,
+                   int poses,
+                   RenderKind kind,
+                   int seed,
+                   ClientStats *stats)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                          sizeof(address))) {
+        perror(path);
+        stats->failed = true;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    // the random path, offset so that clients ask for different poses
+    const auto route = MakeCameraPath(PATH_RANDOM, (seed + 1) * poses);
+    const size_t expect = kind == RENDER_FRAMES
+                              ? SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t)
+                              : sizeof(RayCaster::TraceBatch);
+    std::vector<uint8_t> message(sizeof(RenderRequest) +
+                                 poses * sizeof(RenderPose));
+    std::vector<uint8_t> payload;
+    for (int r = 0; r < requests && !stats->failed; r++) {
+        RenderRequest request = {RENDER_MAGIC, static_cast<uint32_t>(r),
+                                 static_cast<uint16_t>(kind),
+                                 static_cast<uint16_t>(poses)};
+        memcpy(message.data(), &request, sizeof(request));
+        for (int p = 0; p < poses; p++) {
+            const CameraPose &pose = route[seed * poses + p];
+            const RenderPose out = {pose.playerX, pose.playerY,
+                                    pose.playerA + 0.01f * r};
+            memcpy(message.data() + sizeof(request) + p * sizeof(out), &out,
+                   sizeof(out));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        RenderResponse response;
+        if (!WriteAll(fd, message.data(), message.size()) ||
+            !ReadAll(fd, &response, sizeof(response))) {
+            stats->failed = true;
+            break;
+        }
+        payload.resize(response.bytes);
+        if (!ReadAll(fd, payload.data(), payload.size())) {
+            stats->failed = true;
+            break;
+        }
+        const std::chrono::duration<double> seconds =
+            std::chrono::steady_clock::now() - start;
+        if (response.magic != RENDER_MAGIC || response.id != request.id ||
+            response.status != 0 || response.bytes != poses * expect) {
+            fprintf(stderr, "bad response to request %d\n", r);
+            stats->failed = true;
+            break;
+        }
+        stats->bytes += response.bytes;
+        stats->latency.push_back(seconds.count());
+        stats->queued += response.queued;
+    }
+    close(fd);
+}
+
+int main(int argc, char *args[])
+{
+    int requests = 100;
+    int poses = 4;
+    RenderKind kind = RENDER_FRAMES;
+    int clients = 1;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-n") && i + 1 < argc) {
+            requests = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-b") && i + 1 < argc) {
+            poses = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-t")) {
+            kind = RENDER_TRACE;
+        } else if (!strcmp(args[i], "-c") && i + 1 < argc) {
+            clients = atoi(args[++i]);
+        } else if (!path && args[i][0] != '-') {
+            path = args[i];
+        } else {
+            Usage(args[0]);
+            return 1;
+        }
+    }
+    if (!path || requests <= 0 || poses <= 0 || poses > RENDER_MAX_POSES ||
+        clients <= 0) {
+        Usage(args[0]);
+        return 1;
+    }
+
+    std::vector<ClientStats> stats(clients);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back(Client, path, requests, poses, kind, c,
+                             &stats[c]);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    const std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+
+    std::vector<double> latency;
+    uint64_t bytes = 0;
+    uint64_t queued = 0;
+    bool failed = false;
+    for (const auto &s : stats) {
+        latency.insert(latency.end(), s.latency.begin(), s.latency.end());
+        bytes += s.bytes;
+        queued += s.queued;
+        failed |= s.failed;
+    }
+    if (latency.empty()) {
+        return 1;
+    }
+    std::sort(latency.begin(), latency.end());
+    const size_t answered = latency.size();
+    fprintf(stderr,
+            "%zu requests, %zu poses, %.1f MB in %.2f s: %.1f poses/s\n"
+            "round trip median %.2f ms, p99 %.2f ms, max %.2f ms, "
+            "queue depth mean %.1f\n",
+            answered, answered * poses, bytes / 1e6, seconds.count(),
+            answered * poses / seconds.count(),
+            latency[answered / 2] * 1000.0,
+            latency[std::min(answered - 1, answered * 99 / 100)] * 1000.0,
+            latency.back() * 1000.0, queued / static_cast<double>(answered));
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+// renders camera poses for other local processes, see render_server.h for
+// the protocol:
+//   render_server -j 8 /tmp/raycaster.sock
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+
+#include "raycaster_fixed.h"
+#include "render_server.h"
+#include "thread_pool.h"
+
+static RenderServer *server;
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-j threads] [-f] [-d tiles] [-q] socket\n"
+            "  -j  render threads, 1 renders on the serving thread\n"
+            "  -f  textured floor and ceiling\n"
+            "  -d  fade to fog over this many tiles\n"
+            "  -q  no per second latency and queue depth report\n",
+            name);
+}
+
+static void Stop(int)
+{
+    server->Stop();
+}
+
+int main(int argc, char *args[])
+{
+    unsigned threads = 1;
+    bool texturedFloor = false;
+    float fog = 0;
+    bool report = true;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "-j") && i + 1 < argc) {
+            threads = atoi(args[++i]);
+        } else if (!strcmp(args[i], "-f")) {
+            texturedFloor = true;
+        } else if (!strcmp(args[i], "-d") && i + 1 < argc) {
+            fog = atof(args[++i]);
+        } else if (!strcmp(args[i], "-q")) {
+            report = false;
+        } else if (!path && args[i][0] != '-') {
+            path = args[i];
+        } else {
+            Usage(args[0]);
+            return 1;
+        }
+    }
+    if (!path) {
+        Usage(args[0]);
+        return 1;
+    }
+
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool.reset(new ThreadPool(threads));
+    }
+    RayCasterFixed caster;
+    auto listening = RenderServer::Listen(path, caster, pool.get());
+    if (!listening) {
+        perror(path);
+        return 1;
+    }
+    Shading shading;
+    shading.SetFog(FOG_COLOUR, fog);
+    listening->SetShading(&shading);
+    listening->SetTexturedFloor(texturedFloor);
+    listening->SetReport(report);
+
+    // the socket is unlinked on the way out
+    server = listening.get();
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+    fprintf(stderr, "serving on %s\n", path);
+    server->Run();
+    return 0;
+}
@@ -0,0 +1,249 @@
+#include "video_writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// rows converted per thread pool task
+#define VIDEO_BAND 16
+#define Y4M_FRAME "FRAME\n"
+
+static_assert(SCREEN_WIDTH % 8 == 0 && SCREEN_HEIGHT % VIDEO_BAND == 0,
+              "the frame must split into 8 x 2 conversion blocks and bands");
+
+// BT.601 limited range, in 8.8 fixed point
+static inline uint8_t Luma(int r, int g, int b)
+{
+    return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static inline uint8_t ChromaU(int r, int g, int b)
+{
+    return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+static inline uint8_t ChromaV(int r, int g, int b)
+{
+    return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+#ifdef __SSE2__
+// red, green and blue of 8 pixels as 16-bit lanes
+static inline void Channels(const uint32_t *pixels,
+                            __m128i *r,
+                            __m128i *g,
+                            __m128i *b)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i lo =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels));
+    const __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 4));
+    *b = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+    *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+                         _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+    *r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+                         _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+}
+
+// the weighted sum fits 16 bits unsigned
+static inline __m128i Luma8(__m128i r, __m128i g, __m128i b)
+{
+    __m128i y = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                      _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+        _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)),
+                      _mm_set1_epi16(128)));
+    y = _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+    return _mm_packus_epi16(y, y);
+}
+
+// the mean of each 2 x 2 block of two rows of 8, in lanes 0 to 3
+static inline __m128i Mean4(__m128i top, __m128i bottom)
+{
+    const __m128i sum =
+        _mm_madd_epi16(_mm_add_epi16(top, bottom), _mm_set1_epi16(1));
+    const __m128i mean =
+        _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(2)), 2);
+    return _mm_packs_epi32(mean, mean);
+}
+
+// the weighted sums fit 16 bits signed
+static inline __m128i Chroma4(__m128i r,
+                              __m128i g,
+                              __m128i b,
+                              int16_t kr,
+                              int16_t kg,
+                              int16_t kb)
+{
+    __m128i c = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(kr)),
+                      _mm_mullo_epi16(g, _mm_set1_epi16(kg))),
+        _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(kb)),
+                      _mm_set1_epi16(128)));
+    c = _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+    return _mm_packus_epi16(c, c);
+}
+#endif
+
+void ConvertI420(const RenderTarget<uint32_t> &frame,
+                 int first,
+                 int count,
+                 uint8_t *y,
+                 uint8_t *u,
+                 uint8_t *v)
+{
+    const auto *rows = reinterpret_cast<const uint8_t *>(frame.pixels);
+    for (int row = first; row < first + count; row += 2) {
+        const auto *top =
+            reinterpret_cast<const uint32_t *>(rows + row * frame.pitch);
+        const auto *bottom = reinterpret_cast<const uint32_t *>(
+            rows + (row + 1) * frame.pitch);
+        uint8_t *yTop = y + row * SCREEN_WIDTH;
+        uint8_t *yBottom = yTop + SCREEN_WIDTH;
+        uint8_t *uRow = u + row / 2 * (SCREEN_WIDTH / 2);
+        uint8_t *vRow = v + row / 2 * (SCREEN_WIDTH / 2);
+        int x = 0;
+#ifdef __SSE2__
+        for (; x < SCREEN_WIDTH; x += 8) {
+            __m128i r0, g0, b0, r1, g1, b1;
+            Channels(top + x, &r0, &g0, &b0);
+            Channels(bottom + x, &r1, &g1, &b1);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(yTop + x),
+                             Luma8(r0, g0, b0));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(yBottom + x),
+                             Luma8(r1, g1, b1));
+            const __m128i r = Mean4(r0, r1);
+            const __m128i g = Mean4(g0, g1);
+            const __m128i b = Mean4(b0, b1);
+            const int32_t us =
+                _mm_cvtsi128_si32(Chroma4(r, g, b, -38, -74, 112));
+            const int32_t vs =
+                _mm_cvtsi128_si32(Chroma4(r, g, b, 112, -94, -18));
+            memcpy(uRow + x / 2, &us, 4);
+            memcpy(vRow + x / 2, &vs, 4);
+        }
+#endif
+        for (; x < SCREEN_WIDTH; x += 2) {
+            int sum[3] = {0, 0, 0};
+            for (const uint32_t c :
+                 {top[x], top[x + 1], bottom[x], bottom[x + 1]}) {
+                sum[0] += (c >> 16) & 0xFF;
+                sum[1] += (c >> 8) & 0xFF;
+                sum[2] += c & 0xFF;
+            }
+            for (int i = 0; i < 2; i++) {
+                yTop[x + i] = Luma((top[x + i] >> 16) & 0xFF,
+                                   (top[x + i] >> 8) & 0xFF, top[x + i] & 0xFF);
+                yBottom[x + i] =
+                    Luma((bottom[x + i] >> 16) & 0xFF,
+                         (bottom[x + i] >> 8) & 0xFF, bottom[x + i] & 0xFF);
+            }
+            const int r = (sum[0] + 2) >> 2;
+            const int g = (sum[1] + 2) >> 2;
+            const int b = (sum[2] + 2) >> 2;
+            uRow[x / 2] = ChromaU(r, g, b);
+            vRow[x / 2] = ChromaV(r, g, b);
+        }
+    }
+}
+
+bool VideoWriter::Write(const RenderTarget<uint32_t> &frame)
+{
+    if (_failed) {
+        return false;
+    }
+    if (_used + _frameSize > VIDEO_BUFFER_SIZE && !Flush()) {
+        return false;
+    }
+    uint8_t *out = _buffer.get() + _used;
+    if (_format == VIDEO_RAW) {
+        const auto *rows = reinterpret_cast<const uint8_t *>(frame.pixels);
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            memcpy(out + y * SCREEN_WIDTH * sizeof(uint32_t),
+                   rows + y * frame.pitch, SCREEN_WIDTH * sizeof(uint32_t));
+        }
+    } else {
+        memcpy(out, Y4M_FRAME, strlen(Y4M_FRAME));
+        uint8_t *y = out + strlen(Y4M_FRAME);
+        uint8_t *u = y + SCREEN_WIDTH * SCREEN_HEIGHT;
+        uint8_t *v = u + SCREEN_WIDTH * SCREEN_HEIGHT / 4;
+        if (_pool == nullptr) {
+            ConvertI420(frame, 0, SCREEN_HEIGHT, y, u, v);
+        } else {
+            _pool->Run(SCREEN_HEIGHT / VIDEO_BAND, [&](int band) {
+                ConvertI420(frame, band * VIDEO_BAND, VIDEO_BAND, y, u, v);
+            });
+        }
+    }
+    _used += _frameSize;
+    _frames++;
+    return true;
+}
+
+bool VideoWriter::Flush()
+{
+    size_t done = 0;
+    while (!_failed && done < _used) {
+        const ssize_t n = write(_fd, _buffer.get() + done, _used - done);
+        if (n < 0 && errno != EINTR) {
+            _failed = true;
+        } else if (n > 0) {
+            done += n;
+        }
+    }
+    _bytes += done;
+    _used = 0;
+    return !_failed;
+}
+
+std::unique_ptr<VideoWriter> VideoWriter::Open(const char *path,
+                                               VideoFormat format,
+                                               int fps,
+                                               ThreadPool *pool)
+{
+    const bool out = !strcmp(path, "-");
+    const int fd =
+        out ? STDOUT_FILENO : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    std::unique_ptr<VideoWriter> writer(new VideoWriter(fd, format, pool));
+    if (!writer->_buffer) {
+        return nullptr;
+    }
+    if (format == VIDEO_Y4M) {
+        // chroma sited in the middle of each 2 x 2 block, as averaged
+        writer->_used = snprintf(
+            reinterpret_cast<char *>(writer->_buffer.get()), 256,
+            "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", SCREEN_WIDTH,
+            SCREEN_HEIGHT, fps);
+    }
+    return writer;
+}
+
+VideoWriter::VideoWriter(int fd, VideoFormat format, ThreadPool *pool)
+    : _fd(fd), _format(format), _pool(pool), _buffer(nullptr, free)
+{
+    _frameSize = format == VIDEO_RAW
+                     ? SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t)
+                     : strlen(Y4M_FRAME) + SCREEN_WIDTH * SCREEN_HEIGHT * 3 / 2;
+    void *buffer;
+    if (posix_memalign(&buffer, 4096, VIDEO_BUFFER_SIZE) == 0) {
+        _buffer.reset(static_cast<uint8_t *>(buffer));
+    }
+}
+
+VideoWriter::~VideoWriter()
+{
+    Flush();
+    if (_fd != STDOUT_FILENO) {
+        close(_fd);
+    }
+}
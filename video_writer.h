@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include "renderer.h"
+#include "thread_pool.h"
+
+// frames are gathered into a buffer of this many bytes and written to the
+// output in one go when the next one no longer fits
+#define VIDEO_BUFFER_SIZE (4 << 20)
+
+enum VideoFormat {
+    VIDEO_RAW,  // ARGB frames as traced, back to back
+    VIDEO_Y4M,  // YUV4MPEG2, 4:2:0 BT.601 limited range
+};
+
+// streams SCREEN_WIDTH x SCREEN_HEIGHT frames to a file or pipe for an
+// encoder to pick up, without a display
+class VideoWriter
+{
+public:
+    // fps frames per second to path, "-" for standard output; nullptr if it
+    // can't be opened. Y4M frames are converted in bands over pool when it
+    // is not null
+    static std::unique_ptr<VideoWriter> Open(const char *path,
+                                             VideoFormat format,
+                                             int fps,
+                                             ThreadPool *pool = nullptr);
+
+    // false once a write failed, the frames from then on are dropped
+    bool Write(const RenderTarget<uint32_t> &frame);
+    // write out the buffered frames
+    bool Flush();
+    uint64_t Frames() const { return _frames; }
+    uint64_t Bytes() const { return _bytes; }
+
+    // flushes and closes the output
+    ~VideoWriter();
+
+private:
+    VideoWriter(int fd, VideoFormat format, ThreadPool *pool);
+
+    int _fd;
+    VideoFormat _format;
+    ThreadPool *_pool;
+    size_t _frameSize;
+    // page aligned, _used bytes of it waiting to be written
+    std::unique_ptr<uint8_t, void (*)(void *)> _buffer;
+    size_t _used = 0;
+    bool _failed = false;
+    uint64_t _frames = 0;
+    uint64_t _bytes = 0;
+};
+
+// rows first to first + count (both even) of an ARGB frame into y, u and
+// v, the planes of the whole 4:2:0 frame; chroma from the mean of each
+// 2 x 2 block
+void ConvertI420(const RenderTarget<uint32_t> &frame,
+                 int first,
+                 int count,
+                 uint8_t *y,
+                 uint8_t *u,
+                 uint8_t *v);